@@ -0,0 +1,34 @@
+# PlatformIO post build step ([env:circuitplay_classic]): static SRAM
+# report for the firmware. Prints the .data + .bss total against the
+# 32u4's 2560 bytes and the largest RAM symbols, so a layout change shows
+# up in the build log. The stack gets whatever is left.
+Import("env")
+
+import subprocess
+
+SRAM_BYTES = 2560
+TOP = 12
+
+
+def sram_report(source, target, env):
+    elf = str(target[0])
+    out = subprocess.check_output(
+        ["avr-nm", "--size-sort", "-S", "-C", elf], env=env["ENV"]
+    ).decode()
+
+    symbols = []
+    for line in out.splitlines():
+        parts = line.split(None, 3)
+        # address size type name, RAM symbols are b/B (bss) and d/D (data)
+        if len(parts) == 4 and parts[2] in "bBdD":
+            symbols.append((int(parts[1], 16), parts[2].lower(), parts[3]))
+
+    data = sum(s for s, t, _ in symbols if t == "d")
+    bss = sum(s for s, t, _ in symbols if t == "b")
+    print("Static SRAM: %d bytes (.data %d + .bss %d) of %d, %d left for the stack"
+          % (data + bss, data, bss, SRAM_BYTES, SRAM_BYTES - data - bss))
+    for size, kind, name in sorted(symbols, reverse=True)[:TOP]:
+        print("  %5d  .%s  %s" % (size, "data" if kind == "d" else "bss", name))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", sram_report)
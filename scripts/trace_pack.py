@@ -0,0 +1,62 @@
+# Packs raw LIS3DH recordings into a trace file (src/tools/trace.h) for
+# the trace_replay host tool.
+#
+#   python3 scripts/trace_pack.py [--odr 100] out.trc KINDS:GESTURE:FILE...
+#
+# FILE is a native simulator script ("sample x y z" lines, see
+# hal_native.cpp) or plain "x,y,z" lines of raw left justified register
+# values. Every "press" line starts a new capture, so a script that
+# records a key and then an unlock gives two traces. KINDS names them in
+# order (key or unlock, comma separated, the last one repeats), GESTURE
+# is their gesture id, e.g. key,unlock:3:pass.txt
+import argparse
+import struct
+import sys
+
+MAGIC = b"SNTR"
+VERSION = 1
+KINDS = {"key": 0, "unlock": 1}
+
+
+def captures(path):
+    runs = [[]]
+    with open(path) as f:
+        for line in f:
+            words = line.replace(",", " ").split()
+            if not words or words[0].startswith("#"):
+                continue
+            if words[0] == "press":
+                if runs[-1]:
+                    runs.append([])
+            elif words[0] == "sample":
+                runs[-1].append(tuple(int(v) for v in words[1:4]))
+            elif len(words) == 3 and words[0].lstrip("-").isdigit():
+                runs[-1].append(tuple(int(v) for v in words))
+    return [r for r in runs if r]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="pack raw LIS3DH recordings")
+    parser.add_argument("--odr", type=int, default=100, help="raw sample rate (Hz)")
+    parser.add_argument("out")
+    parser.add_argument("specs", nargs="+", metavar="KINDS:GESTURE:FILE")
+    args = parser.parse_args()
+
+    records = []
+    for spec in args.specs:
+        kinds, gesture, path = spec.split(":", 2)
+        kinds = [KINDS[k] for k in kinds.split(",")]
+        for i, samples in enumerate(captures(path)):
+            records.append((int(gesture), kinds[min(i, len(kinds) - 1)], samples))
+
+    with open(args.out, "wb") as f:
+        f.write(MAGIC + struct.pack("<HHII", VERSION, args.odr, len(records), 0))
+        for gesture, kind, samples in records:
+            f.write(struct.pack("<HBBI", gesture, kind, 0, len(samples)))
+            for x, y, z in samples:
+                f.write(struct.pack("<hhh", x, y, z))
+    print("%s: %d traces" % (args.out, len(records)), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
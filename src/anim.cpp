@@ -0,0 +1,69 @@
+#include "anim.h"
+#include "colorlib.h"
+
+static uint8_t effect = ANIM_SOLID;
+static uint32_t base = 0;       // color given to animStart()
+static uint32_t current = 0;    // whole strip color of the current frame
+static uint16_t frame = 0;
+static uint16_t done = 0;
+static uint16_t total = 1;
+
+// scales each channel of a packed color by level / 256
+static uint32_t dim(uint32_t c, uint8_t level) {
+  uint16_t l = (uint16_t)level + 1;
+  return colorlib::Color((uint8_t)(((uint8_t)(c >> 16) * l) >> 8),
+                         (uint8_t)(((uint8_t)(c >> 8) * l) >> 8),
+                         (uint8_t)(((uint8_t)c * l) >> 8),
+                         (uint8_t)(((uint8_t)(c >> 24) * l) >> 8));
+}
+
+// current frame color for the whole strip effects
+static void render() {
+  switch (effect) {
+    case ANIM_BREATHE: {
+      // triangle wave, gamma corrected so the fade looks even
+      uint16_t half = ANIM_BREATHE_FRAMES / 2;
+      uint16_t pos = frame % ANIM_BREATHE_FRAMES;
+      if (pos >= half) pos = ANIM_BREATHE_FRAMES - pos;
+      uint8_t level = colorlib::gamma8((uint8_t)(pos * 255 / half));
+      if (level < ANIM_BREATHE_MIN) level = ANIM_BREATHE_MIN;
+      current = dim(base, level);
+      break;
+    }
+    case ANIM_FLASH:
+      current = ((frame / ANIM_FLASH_FRAMES) & 1) ? 0 : base;
+      break;
+    default:
+      current = base;
+      break;
+  }
+}
+
+void animStart(uint8_t e, uint32_t color) {
+  effect = e;
+  base = color;
+  frame = 0;
+  done = 0;
+  render();
+}
+
+void animProgress(uint16_t d, uint16_t t) {
+  done = d;
+  total = t ? t : 1;
+}
+
+void animStep() {
+  frame++;
+  render();
+}
+
+uint32_t animPixel(uint16_t i, uint16_t n) {
+  if (effect != ANIM_PROGRESS) return current;
+
+  // bar length in 1/256 pixels, the leading pixel fades in
+  uint32_t lit = ((uint32_t)done * n << 8) / total;
+  uint16_t full = lit >> 8;
+  if (i < full) return base;
+  if (i == full) return dim(base, lit & 0xFF);
+  return 0;
+}
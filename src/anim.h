@@ -0,0 +1,36 @@
+#ifndef ANIM_H
+#define ANIM_H
+
+// frame based LED animations
+// animStep() advances one frame per ANIM_FRAME_MS scheduler tick and
+// animPixel() gives the color of each pixel in the current frame. Only
+// color math lives here, the caller owns the strip and decides when the
+// frame is transmitted.
+
+#include <stdint.h>
+
+#define ANIM_FRAME_MS 40        // frame period, one frame per sample at 25Hz
+#define ANIM_BREATHE_FRAMES 64  // breathing period (2.56s)
+#define ANIM_BREATHE_MIN 24     // dimmest breathing level out of 255
+#define ANIM_FLASH_FRAMES 4     // frames on, then as many off
+
+enum animEffect {
+    ANIM_SOLID,      // constant color
+    ANIM_BREATHE,    // slow fade in and out
+    ANIM_PROGRESS,   // bar that fills with animProgress()
+    ANIM_FLASH,      // blinks on and off
+};
+
+// switches to an effect with a packed colorlib::Color() value, frame 0
+void animStart(uint8_t effect, uint32_t color);
+
+// progress for ANIM_PROGRESS, done out of total
+void animProgress(uint16_t done, uint16_t total);
+
+// advances one frame
+void animStep();
+
+// color of pixel i of n in the current frame
+uint32_t animPixel(uint16_t i, uint16_t n);
+
+#endif
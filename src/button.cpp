@@ -0,0 +1,30 @@
+#include "button.h"
+#include "events.h"
+#include "hal.h"
+
+static volatile bool locked = false;   // edge interrupt off until release
+static uint8_t releasedTicks = 0;
+
+void buttonBegin() {
+  halButtonBegin();
+  halButtonIntEnable();
+}
+
+// edge interrupt on the button pin
+void onButtonEdge() {
+  halButtonIntDisable();
+  locked = true;
+  eventPost(EV_BUTTON);
+}
+
+void buttonService() {
+  if (!locked) return;
+
+  if (halButtonPressed()) {
+    releasedTicks = 0;
+  } else if (++releasedTicks >= BUTTON_RELEASE_TICKS) {
+    releasedTicks = 0;
+    locked = false;
+    halButtonIntEnable();
+  }
+}
@@ -0,0 +1,18 @@
+#ifndef BUTTON_H
+#define BUTTON_H
+
+// interrupt driven, debounced button
+// the first rising edge posts EV_BUTTON straight from the edge interrupt,
+// then the interrupt stays off (bounces are ignored) until buttonService()
+// has seen the button released for BUTTON_RELEASE_TICKS polls in a row.
+
+#include <stdint.h>
+
+#define BUTTON_RELEASE_TICKS 3   // released polls needed to rearm
+
+void buttonBegin();
+
+// scheduler task, rearms the edge interrupt after a stable release
+void buttonService();
+
+#endif
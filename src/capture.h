@@ -0,0 +1,37 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+
+// packed capture sample
+// one interleaved XYZ record per sample, each axis quantized to 8 bits:
+// the filtered 12 bit reading (+-2g, 1mg per LSB in high resolution mode)
+// rounded to SAMPLE_SHIFT fewer bits, 16mg per LSB. 3 bytes per sample
+// instead of three separate int16 arrays (6 bytes).
+#define SAMPLE_SHIFT 4
+
+struct packedSample {
+    int8_t x;
+    int8_t y;
+    int8_t z;
+};
+
+// filtered reading -> quantized value, rounded and saturated
+inline int8_t sampleQuantize(int16_t v) {
+    int16_t q = (v + (1 << (SAMPLE_SHIFT - 1))) >> SAMPLE_SHIFT;
+    if (q > 127) q = 127;
+    if (q < -128) q = -128;
+    return (int8_t)q;
+}
+
+// quantized value -> reading in the original units
+inline int16_t sampleValue(int8_t q) {
+    return (int16_t)q * (1 << SAMPLE_SHIFT);
+}
+
+inline packedSample samplePack(int16_t x, int16_t y, int16_t z) {
+    packedSample s = {sampleQuantize(x), sampleQuantize(y), sampleQuantize(z)};
+    return s;
+}
+
+#endif
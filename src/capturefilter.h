@@ -0,0 +1,67 @@
+#ifndef CAPTUREFILTER_H
+#define CAPTUREFILTER_H
+
+#include <stdint.h>
+#include <cic.h>
+#include <movingavg.h>
+#include <capture.h>
+
+// raw LIS3DH samples -> packed capture samples
+// the whole conditioning chain of a capture, shared by the firmware and
+// the host tools: 12 bit conversion, CIC decimation by R (order N), a
+// moving average of W samples at the decimated rate, 8 bit packing.
+// The three axes run in step, one decimation phase for all of them.
+template <uint8_t R, uint8_t N, uint8_t W>
+class captureFilter {
+public:
+    captureFilter(void) { clear(); }
+
+    // first half: conversion and decimation, in place. Returns true every
+    // R samples, when x, y, z hold a decimated reading (mg)
+    bool decimate(int16_t &x, int16_t &y, int16_t &z) {
+        //Data in the form of a 12 bit 2's complement left justifed
+        //(high resolution mode), shift right by 4
+        x = (x >> 4);
+        y = (y >> 4);
+        z = (z >> 4);
+
+        bool ready = X_decim.update(x, &x);
+        Y_decim.update(y, &y);
+        Z_decim.update(z, &z);
+        return ready;
+    }
+
+    // second half: smooth a decimated reading and pack it
+    packedSample smooth(int16_t x, int16_t y, int16_t z) {
+        return samplePack(X_filter.update(x),
+                          Y_filter.update(y),
+                          Z_filter.update(z));
+    }
+
+    // both halves, returns true when a sample came out in *out
+    bool update(int16_t x, int16_t y, int16_t z, packedSample *out) {
+        if (!decimate(x, y, z)) return false;
+        *out = smooth(x, y, z);
+        return true;
+    }
+
+    // every capture starts from an empty window
+    void clear(void) {
+        X_filter.clear();
+        Y_filter.clear();
+        Z_filter.clear();
+        X_decim.clear();
+        Y_decim.clear();
+        Z_decim.clear();
+    }
+
+private:
+    movingavg<W> X_filter;
+    movingavg<W> Y_filter;
+    movingavg<W> Z_filter;
+    cic<R, N> X_decim;
+    cic<R, N> Y_decim;
+    cic<R, N> Z_decim;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef CIC_H
+#define CIC_H
+
+#include <stdint.h>
+#include <string.h>
+
+// integer CIC decimator: N integrators at the input rate, decimate by R,
+// N combs at the output rate, divided by the R^N gain. Multiplier free,
+// a sinc^N low pass with nulls at every multiple of the output rate, so
+// anything that would alias onto the matching rate is knocked down
+// before the samples are dropped.
+// integrators run modulo 2^32, which is fine for a CIC as long as the
+// final (gain scaled) output fits: 16 bit input and R^N <= 2^16.
+template <uint8_t R, uint8_t N = 3>
+class cic {
+public:
+    cic(void) { clear(); }
+
+    // push an input sample, returns true and sets *out every R samples
+    bool update(int16_t sample, int16_t *out) {
+        uint32_t v = (uint32_t)(int32_t)sample;
+        for (uint8_t i = 0; i < N; i++) {
+            integ[i] += v;
+            v = integ[i];
+        }
+        if (++phase < R) return false;
+        phase = 0;
+
+        for (uint8_t i = 0; i < N; i++) {
+            uint32_t d = v - comb[i];
+            comb[i] = v;
+            v = d;
+        }
+        *out = (int16_t)((int32_t)v / gain());
+        return true;
+    }
+
+    // reset all stages to zero
+    void clear(void) {
+        memset((void *)integ, 0, sizeof(integ));
+        memset((void *)comb, 0, sizeof(comb));
+        phase = 0;
+    }
+
+    static constexpr int32_t gain(uint8_t n = N) {
+        return n ? (int32_t)R * gain(n - 1) : 1;
+    }
+
+protected:
+    uint32_t integ[N];  // integrator stages
+    uint32_t comb[N];   // previous input of each comb stage
+    uint8_t phase;      // input samples since the last output
+};
+
+#endif
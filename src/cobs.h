@@ -0,0 +1,40 @@
+#ifndef COBS_H
+#define COBS_H
+
+// consistent overhead byte stuffing
+// removes every 0x00 from a frame so 0x00 can delimit frames on the wire
+
+#include <stdint.h>
+#include <stddef.h>
+
+// encodes buf[1..len] in place, buf[0] is overwritten with the first code
+// byte, so the encoded frame is buf[0..len]. Only for len <= 253, which
+// never needs the 0xFF split code.
+inline void cobsEncodeInPlace(uint8_t *buf, uint8_t len) {
+    uint8_t code = 0;   // index of the pending code byte
+    for (uint8_t i = 1; i <= len; i++) {
+        if (buf[i] == 0) {
+            buf[code] = i - code;
+            code = i;
+        }
+    }
+    buf[code] = len + 1 - code;
+}
+
+// decodes one frame (without the 0x00 delimiter) into out, which needs
+// len bytes. Returns the decoded length, or 0 if the frame is malformed.
+inline size_t cobsDecode(const uint8_t *in, size_t len, uint8_t *out) {
+    size_t i = 0;
+    size_t n = 0;
+    while (i < len) {
+        uint8_t code = in[i++];
+        if (code == 0 || i + code - 1 > len) return 0;
+        for (uint8_t k = 1; k < code; k++) {
+            out[n++] = in[i++];
+        }
+        if (code != 0xFF && i < len) out[n++] = 0;
+    }
+    return n;
+}
+
+#endif
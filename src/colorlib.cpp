@@ -1,9 +1,42 @@
 
 
 #include "colorlib.h"
+#include "neotransmit.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#endif
+
+/*
+  8-bit gamma-correction table, gamma 2.6, kept in flash. To regenerate:
+  import math
+  gamma=2.6
+  print([int(math.pow(i/255, gamma)*255+0.5) for i in range(256)])
+*/
+static const uint8_t PROGMEM gammaTable[256] = {
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   1,   1,   1,   1,   1,   1,   1,   1,
+      1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,   2,   3,   3,   3,   3,
+      3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   5,   6,   6,   6,   6,   7,
+      7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  10,  11,  11,  11,  12,  12,
+     13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,  20,
+     20,  21,  21,  22,  22,  23,  24,  24,  25,  25,  26,  27,  27,  28,  29,  29,
+     30,  31,  31,  32,  33,  34,  34,  35,  36,  37,  38,  38,  39,  40,  41,  42,
+     42,  43,  44,  45,  46,  47,  48,  49,  50,  51,  52,  53,  54,  55,  56,  57,
+     58,  59,  60,  61,  62,  63,  64,  65,  66,  68,  69,  70,  71,  72,  73,  75,
+     76,  77,  78,  80,  81,  82,  84,  85,  86,  88,  89,  90,  92,  93,  94,  96,
+     97,  99, 100, 102, 103, 105, 106, 108, 109, 111, 112, 114, 115, 117, 119, 120,
+    122, 124, 125, 127, 129, 130, 132, 134, 136, 137, 139, 141, 143, 145, 146, 148,
+    150, 152, 154, 156, 158, 160, 162, 164, 166, 168, 170, 172, 174, 176, 178, 180,
+    182, 184, 186, 188, 191, 193, 195, 197, 199, 202, 204, 206, 209, 211, 213, 215,
+    218, 220, 223, 225, 227, 230, 232, 235, 237, 240, 242, 245, 247, 250, 252, 255};
 
 colorlib::colorlib(uint16_t n, int16_t p, neoPixelType t)
-    : begun(false), brightness(0), pixels(NULL), endTime(0) {
+    : begun(false), brightness(0), gammaOn(false), pixels(NULL), frame(NULL),
+      endTime(0), dirty(true), framesSent(0), framesSkipped(0) {
   updateType(t);
   updateLength(n);
   setPin(p);
@@ -11,17 +44,21 @@ colorlib::colorlib(uint16_t n, int16_t p, neoPixelType t)
 
 colorlib::~colorlib() {
   free(pixels);
+#ifdef __AVR__
   if(pin >= 0) DDRB &= ~(1 << 0);
+#endif
 }
 
 /*!
   @brief   Configure NeoPixel pin for output.
 */
 void colorlib::begin(void) {
+#ifdef __AVR__
   if(pin >= 0) {
     DDRB |= (1 << 0);
     PORTB &= ~(1 << 0);
   }
+#endif
   begun = true;
 }
 
@@ -39,17 +76,21 @@ void colorlib::updateLength(uint16_t n) {
   free(pixels); // Free existing data (if any)
 
   // Allocate new data -- note: ALL PIXELS ARE CLEARED
+  // (stored colors followed by the scaled transmit frame)
   numBytes = n * ((wOffset == rOffset) ? 3 : 4);
-  if((pixels = (uint8_t *)malloc(numBytes))) {
+  if((pixels = (uint8_t *)malloc(2 * numBytes))) {
     memset(pixels, 0, numBytes);
+    frame = pixels + numBytes;
     numLEDs = n;
+    dirty = true;
   } else {
+    frame = NULL;
     numLEDs = numBytes = 0;
   }
 }
 
 void colorlib::updateType(neoPixelType t) {
-  boolean oldThreeBytesPerPixel = (wOffset == rOffset); // false if RGBW
+  bool oldThreeBytesPerPixel = (wOffset == rOffset); // false if RGBW
 
   wOffset = (t >> 6) & 0b11; // See notes in header file
   rOffset = (t >> 4) & 0b11; // regarding R/G/B/W offsets
@@ -62,426 +103,114 @@ void colorlib::updateType(neoPixelType t) {
   // If bytes-per-pixel has changed (and pixel data was previously
   // allocated), re-allocate to new size. Will clear any data.
   if(pixels) {
-    boolean newThreeBytesPerPixel = (wOffset == rOffset);
+    bool newThreeBytesPerPixel = (wOffset == rOffset);
     if(newThreeBytesPerPixel != oldThreeBytesPerPixel) updateLength(numLEDs);
   }
 }
 
+/*!
+  @brief   Transmit pixel data in RAM to NeoPixels. Does nothing (and
+           keeps interrupts enabled) if no pixel changed since the last
+           transmit, the strip is already showing this frame. Brightness
+           and gamma are applied here, into the transmit frame.
+*/
 void colorlib::show(void) {
 
   if(!pixels) return;
 
+  if(!dirty) {
+    framesSkipped++;
+    return;
+  }
+
  
+  // full brightness without gamma sends the stored colors as they are
+  uint8_t *out = pixels;
+  if(brightness || gammaOn) {
+    scale(frame, pixels, numBytes, brightness, gammaOn);
+    out = frame;
+  }
+
   while(!canShow());
  
 #if !( defined(NRF52) || defined(NRF52_SERIES) )
-  noInterrupts(); // Need 100% focus on instruction timing
+  halInterruptsOff(); // Need 100% focus on instruction timing
 #endif
 
 #ifdef __AVR__
-// AVR MCUs -- ATmega & ATtiny (no XMEGA) ---------------------------------
-
-  volatile uint16_t
-    i   = numBytes; // Loop counter
-  volatile uint8_t
-   *ptr = pixels,   // Pointer to next byte
-    b   = *ptr++,   // Current byte value
-    hi,             // PORT w/output bit set high
-    lo;             // PORT w/output bit set low
-#if (F_CPU >= 7400000UL) && (F_CPU <= 9500000UL)
-
-#ifdef NEO_KHZ400 // 800 KHz check needed only if 400 KHz support enabled
-  if(is800KHz) {
+  transmit(port, pinMask, out, numBytes);
+#else
+  // Host build ([env:native]) -- no strip to clock out.
+  (void)out;
 #endif
 
-    volatile uint8_t n1, n2 = 0;  // First, next bits out
+#if !( defined(NRF52) || defined(NRF52_SERIES) )
+  halInterruptsOn();
+#endif
 
-#if defined(PORTD)
- #if defined(PORTB) || defined(PORTC) || defined(PORTF)
-    if(port == &PORTD) {
- #endif // defined(PORTB/C/F)
-
-      hi = PORTD |  pinMask;
-      lo = PORTD & ~pinMask;
-      n1 = lo;
-      if(b & 0x80) n1 = hi;
-
-      asm volatile(
-       "headD:"                   "\n\t" // Clk  Pseudocode
-        // Bit 7:
-        "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
-        "mov  %[n2]   , %[lo]"    "\n\t" // 1    n2   = lo
-        "out  %[port] , %[n1]"    "\n\t" // 1    PORT = n1
-        "rjmp .+0"                "\n\t" // 2    nop nop
-        "sbrc %[byte] , 6"        "\n\t" // 1-2  if(b & 0x40)
-         "mov %[n2]   , %[hi]"    "\n\t" // 0-1   n2 = hi
-        "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
-        "rjmp .+0"                "\n\t" // 2    nop nop
-        // Bit 6:
-        "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
-        "mov  %[n1]   , %[lo]"    "\n\t" // 1    n1   = lo
-        "out  %[port] , %[n2]"    "\n\t" // 1    PORT = n2
-        "rjmp .+0"                "\n\t" // 2    nop nop
-        "sbrc %[byte] , 5"        "\n\t" // 1-2  if(b & 0x20)
-         "mov %[n1]   , %[hi]"    "\n\t" // 0-1   n1 = hi
-        "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
-        "rjmp .+0"                "\n\t" // 2    nop nop
-        // Bit 5:
-        "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
-        "mov  %[n2]   , %[lo]"    "\n\t" // 1    n2   = lo
-        "out  %[port] , %[n1]"    "\n\t" // 1    PORT = n1
-        "rjmp .+0"                "\n\t" // 2    nop nop
-        "sbrc %[byte] , 4"        "\n\t" // 1-2  if(b & 0x10)
-         "mov %[n2]   , %[hi]"    "\n\t" // 0-1   n2 = hi
-        "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
-        "rjmp .+0"                "\n\t" // 2    nop nop
-        // Bit 4:
-        "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
-        "mov  %[n1]   , %[lo]"    "\n\t" // 1    n1   = lo
-        "out  %[port] , %[n2]"    "\n\t" // 1    PORT = n2
-        "rjmp .+0"                "\n\t" // 2    nop nop
-        "sbrc %[byte] , 3"        "\n\t" // 1-2  if(b & 0x08)
-         "mov %[n1]   , %[hi]"    "\n\t" // 0-1   n1 = hi
-        "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
-        "rjmp .+0"                "\n\t" // 2    nop nop
-        // Bit 3:
-        "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
-        "mov  %[n2]   , %[lo]"    "\n\t" // 1    n2   = lo
-        "out  %[port] , %[n1]"    "\n\t" // 1    PORT = n1
-        "rjmp .+0"                "\n\t" // 2    nop nop
-        "sbrc %[byte] , 2"        "\n\t" // 1-2  if(b & 0x04)
-         "mov %[n2]   , %[hi]"    "\n\t" // 0-1   n2 = hi
-        "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
-        "rjmp .+0"                "\n\t" // 2    nop nop
-        // Bit 2:
-        "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
-        "mov  %[n1]   , %[lo]"    "\n\t" // 1    n1   = lo
-        "out  %[port] , %[n2]"    "\n\t" // 1    PORT = n2
-        "rjmp .+0"                "\n\t" // 2    nop nop
-        "sbrc %[byte] , 1"        "\n\t" // 1-2  if(b & 0x02)
-         "mov %[n1]   , %[hi]"    "\n\t" // 0-1   n1 = hi
-        "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
-        "rjmp .+0"                "\n\t" // 2    nop nop
-        // Bit 1:
-        "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
-        "mov  %[n2]   , %[lo]"    "\n\t" // 1    n2   = lo
-        "out  %[port] , %[n1]"    "\n\t" // 1    PORT = n1
-        "rjmp .+0"                "\n\t" // 2    nop nop
-        "sbrc %[byte] , 0"        "\n\t" // 1-2  if(b & 0x01)
-         "mov %[n2]   , %[hi]"    "\n\t" // 0-1   n2 = hi
-        "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
-        "sbiw %[count], 1"        "\n\t" // 2    i-- (don't act on Z flag yet)
-        // Bit 0:
-        "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
-        "mov  %[n1]   , %[lo]"    "\n\t" // 1    n1   = lo
-        "out  %[port] , %[n2]"    "\n\t" // 1    PORT = n2
-        "ld   %[byte] , %a[ptr]+" "\n\t" // 2    b = *ptr++
-        "sbrc %[byte] , 7"        "\n\t" // 1-2  if(b & 0x80)
-         "mov %[n1]   , %[hi]"    "\n\t" // 0-1   n1 = hi
-        "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
-        "brne headD"              "\n"   // 2    while(i) (Z flag set above)
-      : [byte]  "+r" (b),
-        [n1]    "+r" (n1),
-        [n2]    "+r" (n2),
-        [count] "+w" (i)
-      : [port]   "I" (_SFR_IO_ADDR(PORTD)),
-        [ptr]    "e" (ptr),
-        [hi]     "r" (hi),
-        [lo]     "r" (lo));
-
- #if defined(PORTB) || defined(PORTC) || defined(PORTF)
-    } else // other PORT(s)
- #endif // defined(PORTB/C/F)
-#endif // defined(PORTD)
-
-    // PORTB OUTPUT ----------------------------------------------------
+  endTime = halMicros(); // Save EOD time for latch on next call
+  dirty = false;
+  framesSent++;
+}
 
-#if defined(PORTB)
- #if defined(PORTD) || defined(PORTC) || defined(PORTF)
-    if(port == &PORTB) {
- #endif // defined(PORTD/C/F)
-
-      // Same as above, just switched to PORTB and stripped of comments.
-      hi = PORTB |  pinMask;
-      lo = PORTB & ~pinMask;
-      n1 = lo;
-      if(b & 0x80) n1 = hi;
-
-      asm volatile(
-       "headB:"                   "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n2]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n1]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 6"        "\n\t"
-         "mov %[n2]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n1]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n2]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 5"        "\n\t"
-         "mov %[n1]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n2]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n1]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 4"        "\n\t"
-         "mov %[n2]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n1]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n2]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 3"        "\n\t"
-         "mov %[n1]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n2]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n1]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 2"        "\n\t"
-         "mov %[n2]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n1]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n2]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 1"        "\n\t"
-         "mov %[n1]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n2]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n1]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 0"        "\n\t"
-         "mov %[n2]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "sbiw %[count], 1"        "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n1]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n2]"    "\n\t"
-        "ld   %[byte] , %a[ptr]+" "\n\t"
-        "sbrc %[byte] , 7"        "\n\t"
-         "mov %[n1]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "brne headB"              "\n"
-      : [byte] "+r" (b), [n1] "+r" (n1), [n2] "+r" (n2), [count] "+w" (i)
-      : [port] "I" (_SFR_IO_ADDR(PORTB)), [ptr] "e" (ptr), [hi] "r" (hi),
-        [lo] "r" (lo));
-
- #if defined(PORTD) || defined(PORTC) || defined(PORTF)
+/*!
+  @brief   Copy pixel bytes into a transmit frame through the gamma table
+           (if enabled) and the brightness multiply. Shared by colorlib
+           and StaticStrip.
+  @param   dst         Transmit frame, numBytes long.
+  @param   src         Stored (unscaled) pixel bytes.
+  @param   numBytes    Number of bytes to copy.
+  @param   brightness  Brightness as stored (+1), 0 = full.
+  @param   gamma       true to gamma-correct each byte first.
+*/
+void colorlib::scale(uint8_t *dst, const uint8_t *src, uint16_t numBytes,
+                     uint8_t brightness, bool gamma) {
+  if(gamma) {
+    if(brightness) {
+      while(numBytes--) *dst++ = (pgm_read_byte(&gammaTable[*src++]) * brightness) >> 8;
+    } else {
+      while(numBytes--) *dst++ = pgm_read_byte(&gammaTable[*src++]);
     }
- #endif
- #if defined(PORTC) || defined(PORTF)
-    else
- #endif // defined(PORTC/F)
-#endif // defined(PORTB)
+  } else {
+    while(numBytes--) *dst++ = (*src++ * brightness) >> 8;
+  }
+}
 
-    // PORTC OUTPUT ----------------------------------------------------
+/*!
+  @brief   Gamma-correct an 8-bit color component.
+  @param   x  Input, 0-255.
+  @return  Gamma-adjusted value, 0-255.
+*/
+uint8_t colorlib::gamma8(uint8_t x) {
+  return pgm_read_byte(&gammaTable[x]);
+}
 
+#ifdef __AVR__
+/*!
+  @brief   Clock numBytes of pixel data out on one PORT bit. Interrupts
+           must already be disabled. For strips whose pin is only known
+           at runtime; StaticStrip calls neoTransmit() directly.
+  @param   port      Output PORT register.
+  @param   pinMask   Output PORT bitmask.
+  @param   pixels    Pixel bytes in transmit order.
+  @param   numBytes  Number of bytes to send, at least 1.
+*/
+void colorlib::transmit(volatile uint8_t *port, uint8_t pinMask,
+                        uint8_t *pixels, uint16_t numBytes) {
+#if defined(PORTD)
+  if(port == &PORTD) neoTransmit<NEO_PORTD>(pinMask, pixels, numBytes);
+#endif
+#if defined(PORTB)
+  if(port == &PORTB) neoTransmit<NEO_PORTB>(pinMask, pixels, numBytes);
+#endif
 #if defined(PORTC)
- #if defined(PORTD) || defined(PORTB) || defined(PORTF)
-    if(port == &PORTC) {
- #endif // defined(PORTD/B/F)
-
-      // Same as above, just switched to PORTC and stripped of comments.
-      hi = PORTC |  pinMask;
-      lo = PORTC & ~pinMask;
-      n1 = lo;
-      if(b & 0x80) n1 = hi;
-
-      asm volatile(
-       "headC:"                   "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n2]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n1]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 6"        "\n\t"
-         "mov %[n2]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n1]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n2]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 5"        "\n\t"
-         "mov %[n1]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n2]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n1]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 4"        "\n\t"
-         "mov %[n2]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n1]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n2]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 3"        "\n\t"
-         "mov %[n1]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n2]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n1]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 2"        "\n\t"
-         "mov %[n2]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n1]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n2]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 1"        "\n\t"
-         "mov %[n1]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n2]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n1]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 0"        "\n\t"
-         "mov %[n2]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "sbiw %[count], 1"        "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n1]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n2]"    "\n\t"
-        "ld   %[byte] , %a[ptr]+" "\n\t"
-        "sbrc %[byte] , 7"        "\n\t"
-         "mov %[n1]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "brne headC"              "\n"
-      : [byte] "+r" (b), [n1] "+r" (n1), [n2] "+r" (n2), [count] "+w" (i)
-      : [port] "I" (_SFR_IO_ADDR(PORTC)), [ptr] "e" (ptr), [hi] "r" (hi),
-        [lo] "r" (lo));
-
- #if defined(PORTD) || defined(PORTB) || defined(PORTF)
-    }
- #endif // defined(PORTD/B/F)
- #if defined(PORTF)
-    else
- #endif
-#endif // defined(PORTC)
-
-    // PORTF OUTPUT ----------------------------------------------------
-
-#if defined(PORTF)
- #if defined(PORTD) || defined(PORTB) || defined(PORTC)
-    if(port == &PORTF) {
- #endif // defined(PORTD/B/C)
-
-      hi = PORTF |  pinMask;
-      lo = PORTF & ~pinMask;
-      n1 = lo;
-      if(b & 0x80) n1 = hi;
-
-      asm volatile(
-       "headF:"                   "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n2]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n1]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 6"        "\n\t"
-         "mov %[n2]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n1]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n2]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 5"        "\n\t"
-         "mov %[n1]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n2]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n1]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 4"        "\n\t"
-         "mov %[n2]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n1]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n2]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 3"        "\n\t"
-         "mov %[n1]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n2]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n1]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 2"        "\n\t"
-         "mov %[n2]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n1]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n2]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 1"        "\n\t"
-         "mov %[n1]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n2]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n1]"    "\n\t"
-        "rjmp .+0"                "\n\t"
-        "sbrc %[byte] , 0"        "\n\t"
-         "mov %[n2]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "sbiw %[count], 1"        "\n\t"
-        "out  %[port] , %[hi]"    "\n\t"
-        "mov  %[n1]   , %[lo]"    "\n\t"
-        "out  %[port] , %[n2]"    "\n\t"
-        "ld   %[byte] , %a[ptr]+" "\n\t"
-        "sbrc %[byte] , 7"        "\n\t"
-         "mov %[n1]   , %[hi]"    "\n\t"
-        "out  %[port] , %[lo]"    "\n\t"
-        "brne headF"              "\n"
-      : [byte] "+r" (b), [n1] "+r" (n1), [n2] "+r" (n2), [count] "+w" (i)
-      : [port] "I" (_SFR_IO_ADDR(PORTF)), [ptr] "e" (ptr), [hi] "r" (hi),
-        [lo] "r" (lo));
-
- #if defined(PORTD) || defined(PORTB) || defined(PORTC)
-    }
- #endif // defined(PORTD/B/C)
-#endif // defined(PORTF)
-
-#else
- #error "CPU SPEED NOT SUPPORTED"
-#endif // end F_CPU ifdefs on __AVR__
-
-// END AVR ----------------------------------------------------------------
-
-#else
-#error Architecture not supported
+  if(port == &PORTC) neoTransmit<NEO_PORTC>(pinMask, pixels, numBytes);
 #endif
-
-
-// END ARCHITECTURE SELECT ------------------------------------------------
-
-#if !( defined(NRF52) || defined(NRF52_SERIES) )
-  interrupts();
+#if defined(PORTF)
+  if(port == &PORTF) neoTransmit<NEO_PORTF>(pinMask, pixels, numBytes);
 #endif
-
-  endTime = micros(); // Save EOD time for latch on next call
 }
+#endif
 
 /*!
   @brief   Set/change the NeoPixel output pin number. Previous pin,
@@ -508,39 +237,99 @@ void colorlib::setPixelColor(
  uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
 
   if(n < numLEDs) {
-    if(brightness) { // See notes in setBrightness()
-      r = (r * brightness) >> 8;
-      g = (g * brightness) >> 8;
-      b = (b * brightness) >> 8;
-    }
     uint8_t *p;
     if(wOffset == rOffset) { // Is an RGB-type strip
       p = &pixels[n * 3];    // 3 bytes per pixel
     } else {                 // Is a WRGB-type strip
       p = &pixels[n * 4];    // 4 bytes per pixel
-      p[wOffset] = 0;        // But only R,G,B passed -- set W to 0
+      if(p[wOffset]) {       // But only R,G,B passed -- set W to 0
+        p[wOffset] = 0;
+        dirty = true;
+      }
+    }
+    // only a real change needs a new transmit
+    if(p[rOffset] != r || p[gOffset] != g || p[bOffset] != b) {
+      p[rOffset] = r;        // R,G,B always stored
+      p[gOffset] = g;
+      p[bOffset] = b;
+      dirty = true;
+    }
+  }
+}
+
+/*!
+  @brief   Set a pixel's color using a 32-bit 'packed' RGB or RGBW value.
+  @param   n  Pixel index, starting from 0.
+  @param   c  32-bit color value (see Color()).
+*/
+void colorlib::setPixelColor(uint16_t n, uint32_t c) {
+  fill(c, n, 1);
+}
+
+/*!
+  @brief   Fill all or part of the strip with a color. The byte order is
+           applied once, then the 3 or 4 byte pattern is copied through
+           the range. Colors are stored unscaled (see setBrightness()).
+  @param   c      32-bit color value (see Color()), default 0 (off).
+  @param   first  Index of first pixel to fill, starting from 0.
+  @param   count  Number of pixels to fill, 0 (default) fills to the end.
+*/
+void colorlib::fill(uint32_t c, uint16_t first, uint16_t count) {
+  if(first >= numLEDs) return;
+
+  uint16_t end = numLEDs;
+  if(count && count < numLEDs - first) end = first + count;
+
+  uint8_t r = (uint8_t)(c >> 16);
+  uint8_t g = (uint8_t)(c >>  8);
+  uint8_t b = (uint8_t)c;
+  uint8_t w = (uint8_t)(c >> 24);
+
+  uint8_t pattern[4];
+  uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+  pattern[wOffset] = w;    // overwritten by R below on RGB strips
+  pattern[rOffset] = r;
+  pattern[gOffset] = g;
+  pattern[bOffset] = b;
+
+  // copy the pattern, remembering whether any byte changed
+  uint8_t  changed = 0;
+  uint8_t *p = &pixels[first * bpp];
+  for(uint16_t i = first; i < end; i++) {
+    for(uint8_t k = 0; k < bpp; k++) {
+      changed |= p[k] ^ pattern[k];
+      p[k] = pattern[k];
     }
-    p[rOffset] = r;          // R,G,B always stored
-    p[gOffset] = g;
-    p[bOffset] = b;
+    p += bpp;
   }
+  if(changed) dirty = true;
 }
 
+/*!
+  @brief   Adjust output brightness. Stored colors are not touched, the
+           scaling happens in show(), so this is O(1) and lossless:
+           going down and back up restores the exact colors.
+  @param   b  Brightness setting, 0 = minimum (off), 255 = brightest.
+  @note    Stored as b + 1 so that 255 wraps to 0, meaning no scaling,
+           and the multiply in scale() is a plain (v * brightness) >> 8.
+*/
 void colorlib::setBrightness(uint8_t b) {
   uint8_t newBrightness = b + 1;
-  if(newBrightness != brightness) { 
-    uint8_t  c,
-            *ptr           = pixels,
-             oldBrightness = brightness - 1; // De-wrap old brightness value
-    uint16_t scale;
-    if(oldBrightness == 0) scale = 0; // Avoid /0
-    else if(b == 255) scale = 65535 / oldBrightness;
-    else scale = (((uint16_t)newBrightness << 8) - 1) / oldBrightness;
-    for(uint16_t i=0; i<numBytes; i++) {
-      c      = *ptr;
-      *ptr++ = (c * scale) >> 8;
-    }
+  if(newBrightness != brightness) {
     brightness = newBrightness;
+    dirty = true;
+  }
+}
+
+/*!
+  @brief   Enable or disable gamma correction (see gamma8()) of the
+           transmitted colors. Applied in show(), before brightness.
+  @param   on  true to gamma-correct.
+*/
+void colorlib::setGamma(bool on) {
+  if(on != gammaOn) {
+    gammaOn = on;
+    dirty = true;
   }
 }
 
@@ -548,7 +337,13 @@ void colorlib::setBrightness(uint8_t b) {
   @brief   Fill the whole NeoPixel strip with 0 / black / off.
 */
 void colorlib::clear(void) {
-  memset(pixels, 0, numBytes);
+  for(uint16_t i=0; i<numBytes; i++) {
+    if(pixels[i]) {
+      memset(pixels, 0, numBytes);
+      dirty = true;
+      return;
+    }
+  }
 }
 
 
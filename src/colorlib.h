@@ -1,4 +1,9 @@
-#include <Arduino.h>
+#ifndef COLORLIB_H
+#define COLORLIB_H
+
+#include <hal.h>
+#include <stdlib.h>
+#include <string.h>
 typedef uint16_t neoPixelType; ///< 3rd arg to Adafruit_NeoPixel constructor
 #define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2)) ///< Transmit as G,R,B
 #define NEO_KHZ800 0x0000 ///< 800 KHz data transmission
@@ -13,22 +18,47 @@ public:
     void begin(void);
     void show(void);
     void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b);
+    void setPixelColor(uint16_t n, uint32_t c);
+    void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0);
     void setBrightness(uint8_t);
+    void setGamma(bool on);
     void clear(void);
     void updateLength(uint16_t n);
     void updateType(neoPixelType t);
     void setPin(uint16_t p);
     bool canShow(void) {
-        uint32_t now = micros();
+        uint32_t now = halMicros();
         if (endTime > now) {
         endTime = now;
         }
         return (now - endTime) >= 300L;
     }
 
-    
-    void fill(uint32_t c, uint16_t first, uint16_t count) {
-        uint16_t i, end;
+    static void scale(uint8_t *dst, const uint8_t *src, uint16_t numBytes,
+                      uint8_t brightness, bool gamma);
+    static uint8_t gamma8(uint8_t x);
+#ifdef __AVR__
+    static void transmit(volatile uint8_t *port, uint8_t pinMask,
+                         uint8_t *pixels, uint16_t numBytes);
+#endif
+
+    uint32_t getFramesSent(void) const { return framesSent; }
+    uint32_t getFramesSkipped(void) const { return framesSkipped; }
+
+    /*!
+      @brief   Pack separate red, green and blue values into a single
+               'packed' 32-bit RGB color (0x00RRGGBB).
+    */
+    static constexpr uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+        return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    }
+    /*!
+      @brief   Same as above with a white component (0xWWRRGGBB).
+    */
+    static constexpr uint32_t Color(uint8_t r, uint8_t g, uint8_t b,
+                                    uint8_t w) {
+        return ((uint32_t)w << 24) | ((uint32_t)r << 16) |
+               ((uint32_t)g << 8) | b;
     }
 protected:
     bool begun;         ///< true if begin() previously called
@@ -36,14 +66,21 @@ protected:
     uint16_t numBytes;  ///< Size of 'pixels' buffer below
     int16_t pin;        ///< Output pin number (-1 if not yet set)
     uint8_t brightness; ///< Strip brightness 0-255 (stored as +1)
-    uint8_t *pixels;    ///< Holds LED color values (3 or 4 bytes each)
+    bool gammaOn;       ///< gamma-correct in show()
+    uint8_t *pixels;    ///< Holds unscaled LED colors (3 or 4 bytes each)
+    uint8_t *frame;     ///< Scaled transmit frame, after pixels
     uint8_t rOffset;    ///< Red index within each 3- or 4-byte pixel
     uint8_t gOffset;    ///< Index of green byte
     uint8_t bOffset;    ///< Index of blue byte
     uint8_t wOffset;    ///< Index of white (==rOffset if no white)
     uint32_t endTime;   ///< Latch timing reference
+    bool dirty;         ///< pixels changed since the last show()
+    uint32_t framesSent;    ///< show() calls that transmitted
+    uint32_t framesSkipped; ///< show() calls skipped, nothing changed
     #ifdef __AVR__
     volatile uint8_t *port; ///< Output PORT register
     uint8_t pinMask;        ///< Output PORT bitmask
     #endif
 };
+
+#endif
@@ -0,0 +1,29 @@
+#include "events.h"
+#include "hal.h"
+
+static volatile uint8_t queue[EVENT_QUEUE_SIZE];
+static volatile uint8_t head = 0;   // next slot to read
+static volatile uint8_t tail = 0;   // next slot to write
+
+bool eventPost(uint8_t ev) {
+  uint8_t irq = halIrqSave();
+  bool posted = false;
+  if ((uint8_t)(tail - head) < EVENT_QUEUE_SIZE) {
+    queue[tail & (EVENT_QUEUE_SIZE - 1)] = ev;
+    tail++;
+    posted = true;
+  }
+  halIrqRestore(irq);
+  return posted;
+}
+
+uint8_t eventGet() {
+  uint8_t irq = halIrqSave();
+  uint8_t ev = EV_NONE;
+  if (head != tail) {
+    ev = queue[head & (EVENT_QUEUE_SIZE - 1)];
+    head++;
+  }
+  halIrqRestore(irq);
+  return ev;
+}
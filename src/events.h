@@ -0,0 +1,29 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+// event queue between interrupts, scheduler tasks and the state machine
+// fixed size ring buffer, safe to post from interrupt context
+
+#include <stdint.h>
+
+#define EVENT_QUEUE_SIZE 8   // power of two
+
+enum sentryEvent {
+    EV_NONE = 0,
+    EV_BUTTON,           // button pressed (debounced)
+    EV_CAPTURE_DONE,     // TIMER_COUNT samples recorded (or motion ended)
+    EV_TIMEOUT,          // state timeout expired
+    EV_VALIDATE_PASS,    // unlock matched the key
+    EV_VALIDATE_FAIL,    // unlock rejected
+    EV_MOTION,           // accelerometer activity interrupt
+    EV_KEY_SAVED,        // key written to the key store
+    EV_ERASE,            // serial 'c', erase every key
+};
+
+// returns false (event dropped) if the queue is full
+bool eventPost(uint8_t ev);
+
+// next event, or EV_NONE if the queue is empty
+uint8_t eventGet();
+
+#endif
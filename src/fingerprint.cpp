@@ -0,0 +1,115 @@
+#include "fingerprint.h"
+
+static inline uint8_t saturate8(uint16_t v) {
+  return v > 255 ? 255 : v;
+}
+
+static inline uint16_t absDiff(int16_t a, int16_t b) {
+  return (a > b) ? (uint16_t)(a - b) : (uint16_t)(b - a);
+}
+
+// integer square root, rounded down
+static uint16_t isqrt(uint32_t v) {
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > v) bit >>= 2;
+  while (bit) {
+    if (v >= root + bit) {
+      v -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+void fingerprintBegin(fingerprintAcc &a) {
+  a.index = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    a.sum[i] = 0;
+    a.squares[i] = 0;
+    a.crossings[i] = 0;
+    a.side[i] = 0;
+    a.high[i] = -128;
+    a.low[i] = 127;
+    a.peak[i] = 0;
+    a.trough[i] = 0;
+    for (uint8_t b = 0; b < FP_SEGMENTS; b++) {
+      a.segment[b][i] = 0;
+    }
+  }
+}
+
+// crossings are counted around the mean of the samples so far, the only
+// mean there is while recording; a new side needs FP_HYSTERESIS distance
+void fingerprintAdd(fingerprintAcc &a, const packedSample &s) {
+  uint16_t index = a.index++;
+  if (index < FP_SKIP) return;
+  uint16_t n = index - FP_SKIP;
+  uint8_t bin = n / FP_SEGMENT_SAMPLES;
+
+  const int8_t v[3] = {s.x, s.y, s.z};
+  for (uint8_t i = 0; i < 3; i++) {
+    if (n) {
+      int16_t mean = a.sum[i] / n;
+      int8_t side = 0;
+      if (v[i] >= mean + FP_HYSTERESIS) side = 1;
+      if (v[i] <= mean - FP_HYSTERESIS) side = -1;
+      if (side && a.side[i] && side != a.side[i] && a.crossings[i] < 255) {
+        a.crossings[i]++;
+      }
+      if (side) a.side[i] = side;
+    }
+
+    a.sum[i] += v[i];
+    a.squares[i] += (int16_t)v[i] * v[i];
+    if (v[i] > a.high[i]) {
+      a.high[i] = v[i];
+      a.peak[i] = n;
+    }
+    if (v[i] < a.low[i]) {
+      a.low[i] = v[i];
+      a.trough[i] = n;
+    }
+    if (bin < FP_SEGMENTS) a.segment[bin][i] += v[i];
+  }
+}
+
+void fingerprintEnd(const fingerprintAcc &a, fingerprint *out) {
+  uint16_t n = a.index > FP_SKIP ? a.index - FP_SKIP : 0;
+
+  for (uint8_t i = 0; i < 3; i++) {
+    int16_t mean = n ? a.sum[i] / (int32_t)n : 0;
+    int32_t variance = n ? (int32_t)(a.squares[i] / n) - (int32_t)mean * mean : 0;
+    out->mean[i] = mean;
+    out->rms[i] = saturate8(isqrt(variance > 0 ? variance : 0));
+    out->crossings[i] = a.crossings[i];
+    out->peak[i] = saturate8(a.peak[i]);
+    out->trough[i] = saturate8(a.trough[i]);
+
+    for (uint8_t b = 0; b < FP_SEGMENTS; b++) {
+      uint16_t start = b * FP_SEGMENT_SAMPLES;
+      uint16_t count = n > start ? n - start : 0;
+      if (count > FP_SEGMENT_SAMPLES) count = FP_SEGMENT_SAMPLES;
+      out->segment[b][i] = count ? a.segment[b][i] / (int16_t)count : 0;
+    }
+  }
+}
+
+// levels (mean, rms, segments) count one per unit, a crossing two, and
+// the peak positions a quarter per sample (reaction time moves them)
+uint16_t fingerprintDistance(const fingerprint &a, const fingerprint &b) {
+  uint16_t d = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    d += absDiff(a.mean[i], b.mean[i]);
+    d += absDiff(a.rms[i], b.rms[i]);
+    d += 2 * absDiff(a.crossings[i], b.crossings[i]);
+    d += (absDiff(a.peak[i], b.peak[i]) + absDiff(a.trough[i], b.trough[i])) / 4;
+    for (uint8_t s = 0; s < FP_SEGMENTS; s++) {
+      d += absDiff(a.segment[s][i], b.segment[s][i]);
+    }
+  }
+  return d;
+}
@@ -0,0 +1,63 @@
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+// gesture fingerprint
+// a few numbers per axis that summarize a capture, built sample by sample
+// while recording (no second pass, no buffer). Comparing two fingerprints
+// costs the same for any capture length, so it screens out clearly wrong
+// keys, and ranks the rest, before a sample by sample matcher runs.
+//
+// all values are in packed sample units (16mg, see capture.h) or sample
+// indices, the first FP_SKIP samples (moving average warm-up, as
+// MATCH_START) are left out.
+
+#include <stdint.h>
+#include <capture.h>
+
+#define FP_SKIP 10             // warm-up samples left out
+#define FP_SEGMENTS 4          // coarse time histogram bins
+#define FP_SEGMENT_SAMPLES 16  // samples per bin (640ms at 25Hz)
+#define FP_HYSTERESIS 2        // distance from the mean a crossing needs
+
+// the distance past which a key is not worth matching; loose on purpose,
+// the matcher makes the decision, this only throws out the obvious
+#define FP_REJECT_DISTANCE 96
+
+// a streamed unlock is screened while it is recorded, on the fingerprint
+// of its first FP_EARLY_SAMPLES samples (the warm-up and one bin). Three
+// of the four bins are still empty, so its distances run about half the
+// full ones and so does the threshold.
+#define FP_EARLY_SAMPLES (FP_SKIP + FP_SEGMENT_SAMPLES)
+#define FP_EARLY_REJECT_DISTANCE 48
+
+struct fingerprint {
+    int8_t mean[3];                  // per axis
+    uint8_t rms[3];                  // deviation from the mean (energy)
+    uint8_t crossings[3];            // mean crossings
+    uint8_t peak[3];                 // index of the largest value (max 255)
+    uint8_t trough[3];               // index of the smallest value
+    int8_t segment[FP_SEGMENTS][3];  // mean of each FP_SEGMENT_SAMPLES bin
+};
+
+// running sums, one fingerprintAdd() per recorded sample
+struct fingerprintAcc {
+    uint16_t index;                  // samples seen
+    int32_t sum[3];
+    uint32_t squares[3];
+    uint8_t crossings[3];
+    int8_t side[3];                  // last side of the running mean, 0 unknown
+    int8_t high[3];
+    int8_t low[3];
+    uint16_t peak[3];
+    uint16_t trough[3];
+    int16_t segment[FP_SEGMENTS][3];
+};
+
+void fingerprintBegin(fingerprintAcc &a);
+void fingerprintAdd(fingerprintAcc &a, const packedSample &s);
+void fingerprintEnd(const fingerprintAcc &a, fingerprint *out);
+
+// weighted L1 distance, 0 for identical captures
+uint16_t fingerprintDistance(const fingerprint &a, const fingerprint &b);
+
+#endif
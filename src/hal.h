@@ -0,0 +1,85 @@
+#ifndef HAL_H
+#define HAL_H
+
+// hardware abstraction layer
+// everything the sentry logic needs from the board (SPI, GPIO, timer,
+// serial) goes through these functions. hal_avr.cpp implements them for
+// the Circuit Playground, hal_native.cpp for a Linux host ([env:native])
+// where the accelerometer and button are driven by a script.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+// -------------- SPI (accelerometer) -------------- //
+void halSpiBegin(uint32_t hz);       // CS pin as output, SPI at up to hz
+void halSpiSelect();                 // start a transaction, pull down the accel CS
+void halSpiDeselect();               // release the accel CS, end the transaction
+uint8_t halSpiTransfer(uint8_t out);
+void halSpiRead(uint8_t *buf, size_t len);  // len bytes in (zeros out)
+
+// -------------- GPIO -------------- //
+void halButtonBegin();
+bool halButtonPressed();
+void halButtonIntEnable();           // calls onButtonEdge() on a press edge
+void halButtonIntDisable();
+
+// accelerometer INT1, calls onAccelInterrupt() on a rising edge
+void halAccelIntBegin();
+void halAccelIntEnable();
+void halAccelIntDisable();
+
+// -------------- TIMER -------------- //
+// calls onSampleTimer() hz times per second until stopped
+void halTimerStart(uint16_t hz);
+void halTimerStop();
+
+uint32_t halMillis();
+uint32_t halMicros();
+void halDelay(uint32_t ms);
+
+void halInterruptsOff();
+void halInterruptsOn();
+
+// nestable critical section, safe inside interrupts
+uint8_t halIrqSave();                // disables interrupts, returns old state
+void halIrqRestore(uint8_t state);
+
+// sleeps until the next interrupt
+void halIdle();
+
+// free running counter for profiling, HAL_CYCLES_PER_US ticks per us
+// (CPU cycles from Timer3 on the board, nanoseconds on the host)
+#ifdef ARDUINO
+#define HAL_CYCLES_PER_US (F_CPU / 1000000UL)
+#else
+#define HAL_CYCLES_PER_US 1000
+#endif
+void halCycleBegin();
+uint32_t halCycleCount();
+
+// -------------- EEPROM -------------- //
+#define HAL_EEPROM_SIZE 1024         // ATmega32u4
+uint8_t halEepromRead(uint16_t addr);
+void halEepromWrite(uint16_t addr, uint8_t value);  // no-op if unchanged
+bool halEepromReady();               // no write in progress, the next one starts at once
+
+// -------------- SERIAL -------------- //
+void halSerialBegin(uint32_t baud);
+void halPrint(const char *s);
+void halPrint(long v);
+void halPrintln(const char *s);
+void halPrintln(long v);
+void halSerialWrite(const uint8_t *buf, size_t len);
+int halSerialRead();                 // next received byte or -1
+
+// -------------- APPLICATION HOOKS -------------- //
+// implemented by the application, called in interrupt context
+void onSampleTimer();
+void onAccelInterrupt();
+void onButtonEdge();
+
+#endif
@@ -0,0 +1,273 @@
+// HAL implementation for the Circuit Playground Classic (ATmega32u4)
+#ifdef ARDUINO
+
+#include "hal.h"
+#include "profile.h"
+#include <SPI.h>
+#include <avr/sleep.h>
+#include <avr/eeprom.h>
+
+#define SPI_CS 4           // Accelerometer SPI CS on PB4
+#define BUTTON_PIN 4       // Left button on PD4
+#define ACCEL_INT 6        // Accelerometer INT1 on PE6 (INT6)
+
+// -------------- SPI -------------- //
+// clock, bit order and mode of the accelerometer, loaded into the SPI
+// registers by every transaction
+static SPISettings spiSettings;
+
+void halSpiBegin(uint32_t hz) {
+  // set CS pin as OUTPUT and idle high
+  DDRB |= (1 << SPI_CS);
+  PORTB |= (1 << SPI_CS);
+  SPI.begin();
+  // the library picks the fastest divider at or below hz, the plain
+  // SPI.begin() default is F_CPU / 4
+  spiSettings = SPISettings(hz, MSBFIRST, SPI_MODE0);
+}
+
+void halSpiSelect() {
+  SPI.beginTransaction(spiSettings);
+  PORTB &= ~(1 << SPI_CS);
+}
+
+void halSpiDeselect() {
+  PORTB |= (1 << SPI_CS);
+  SPI.endTransaction();
+}
+
+uint8_t halSpiTransfer(uint8_t out) {
+  return SPI.transfer(out);
+}
+
+// the next byte starts as soon as the last one is in, storing it overlaps
+// the next shift instead of following it
+void halSpiRead(uint8_t *buf, size_t len) {
+  if (!len) return;
+  SPDR = 0;
+  while (--len) {
+    while (!(SPSR & (1 << SPIF)));
+    uint8_t in = SPDR;
+    SPDR = 0;
+    *buf++ = in;
+  }
+  while (!(SPSR & (1 << SPIF)));
+  *buf = SPDR;
+}
+
+// -------------- GPIO -------------- //
+void halButtonBegin() {
+  // Configure DDRD4 Bit as input for the button
+  DDRD &= ~(1 << BUTTON_PIN);
+}
+
+bool halButtonPressed() {
+  return PIND & (1 << BUTTON_PIN);
+}
+
+// PD4 has no INTn or pin change interrupt on the 32u4, but it is ICP1,
+// so the Timer1 input capture edge detector watches it. The edge detector
+// runs whether or not Timer1 is clocked, and works beside the CTC sampling
+void halButtonIntEnable() {
+  TCCR1B |= (1 << ICNC1) | (1 << ICES1);  // noise canceler, rising edge
+  TIFR1 = (1 << ICF1);                     // drop edges seen while disabled
+  TIMSK1 |= (1 << ICIE1);
+}
+
+void halButtonIntDisable() {
+  TIMSK1 &= ~(1 << ICIE1);
+}
+
+ISR(TIMER1_CAPT_vect) {
+  onButtonEdge();
+}
+
+void halAccelIntBegin() {
+  // INT1 on PE6 as input, INT6 on rising edge
+  DDRE &= ~(1 << ACCEL_INT);
+  EICRB |= (1 << ISC61) | (1 << ISC60);
+}
+
+void halAccelIntEnable() {
+  // clear any stale edge before enabling
+  EIFR = (1 << INTF6);
+  EIMSK |= (1 << INT6);
+}
+
+void halAccelIntDisable() {
+  EIMSK &= ~(1 << INT6);
+}
+
+ISR(INT6_vect) {
+  onAccelInterrupt();
+}
+
+// -------------- TIMER -------------- //
+// Timer1 clock select bits and divider, smallest divider first
+static const struct {
+  uint8_t cs;
+  uint16_t div;
+} prescalers[] = {
+  {(1 << CS10), 1},
+  {(1 << CS11), 8},
+  {(1 << CS11) | (1 << CS10), 64},
+  {(1 << CS12), 256},
+  {(1 << CS12) | (1 << CS10), 1024},
+};
+
+// Timer 1 in CTC mode, with the smallest prescaler whose compare value
+// fits in 16 bits (finest resolution, exact for 25Hz to 400Hz at 8MHz)
+void halTimerStart(uint16_t hz) {
+  uint8_t p = 0;
+  while (p < 4 && F_CPU / prescalers[p].div / hz > 65536UL) p++;
+
+  // clear global interrupts
+  cli();
+
+  // clear timer registers before we use them
+  // (keeping the button input capture setup)
+  TCCR1A = 0; // Normal Operations, no PWM
+  TCCR1B &= (1 << ICNC1) | (1 << ICES1);
+  TCNT1 = 0;
+
+  // set CTC mode, clear on OCR1A
+  TCCR1B |= (1 << WGM12);
+
+  TCCR1B |= prescalers[p].cs;
+
+  // counts TOP + 1 timer clocks per period, 40000 for 25Hz at 8MHz
+  OCR1A = F_CPU / prescalers[p].div / hz - 1;
+
+  // Enable Timer1 compare match interrupt
+  TIMSK1 |= (1 << OCIE1A);
+
+  // enable global interrupts
+  sei();
+}
+
+void halTimerStop() {
+  TCCR1B &= ~((1 << CS12) | (1 << CS11) | (1 << CS10));
+}
+
+ISR(TIMER1_COMPA_vect) {
+  onSampleTimer();
+}
+
+uint32_t halMillis() {
+  return millis();
+}
+
+uint32_t halMicros() {
+  return micros();
+}
+
+void halDelay(uint32_t ms) {
+  delay(ms);
+}
+
+void halInterruptsOff() {
+  noInterrupts();
+}
+
+void halInterruptsOn() {
+  interrupts();
+}
+
+uint8_t halIrqSave() {
+  uint8_t sreg = SREG;
+  cli();
+  return sreg;
+}
+
+void halIrqRestore(uint8_t state) {
+  SREG = state;
+}
+
+// idle mode keeps the timers, SPI, USB and input capture running, so any
+// of their interrupts (at the latest the 1ms millis() tick) wakes us up
+void halIdle() {
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_mode();
+}
+
+// -------------- CYCLE COUNTER -------------- //
+// Timer3 counts CPU cycles, its overflow interrupt extends it to 32 bits
+#if PROFILE_ENABLED
+static volatile uint16_t cycleHigh = 0;
+
+ISR(TIMER3_OVF_vect) {
+  cycleHigh++;
+}
+#endif
+
+void halCycleBegin() {
+#if PROFILE_ENABLED
+  TCCR3A = 0;
+  TCCR3B = (1 << CS30);   // no prescaler
+  TCNT3 = 0;
+  TIFR3 = (1 << TOV3);
+  TIMSK3 |= (1 << TOIE3);
+#endif
+}
+
+// safe to call with interrupts on or off (e.g. inside an ISR)
+uint32_t halCycleCount() {
+#if PROFILE_ENABLED
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t low = TCNT3;
+  uint16_t high = cycleHigh;
+  // overflow not serviced yet (interrupts off), count it here
+  if ((TIFR3 & (1 << TOV3)) && low < 0x8000) high++;
+  SREG = sreg;
+  return ((uint32_t)high << 16) | low;
+#else
+  return 0;
+#endif
+}
+
+// -------------- EEPROM -------------- //
+uint8_t halEepromRead(uint16_t addr) {
+  return eeprom_read_byte((const uint8_t *)(uintptr_t)addr);
+}
+
+// update instead of write: an unchanged cell costs no erase cycle (or the
+// 3.4ms programming time)
+void halEepromWrite(uint16_t addr, uint8_t value) {
+  eeprom_update_byte((uint8_t *)(uintptr_t)addr, value);
+}
+
+bool halEepromReady() {
+  return eeprom_is_ready();
+}
+
+// -------------- SERIAL -------------- //
+void halSerialBegin(uint32_t baud) {
+  Serial.begin(baud);
+}
+
+void halPrint(const char *s) {
+  Serial.print(s);
+}
+
+void halPrint(long v) {
+  Serial.print(v);
+}
+
+void halPrintln(const char *s) {
+  Serial.println(s);
+}
+
+void halPrintln(long v) {
+  Serial.println(v);
+}
+
+void halSerialWrite(const uint8_t *buf, size_t len) {
+  Serial.write(buf, len);
+}
+
+int halSerialRead() {
+  return Serial.read();
+}
+
+#endif
@@ -0,0 +1,517 @@
+// HAL implementation for a Linux host ([env:native])
+//
+// runs setup()/loop() against virtual time. The button and accelerometer
+// are driven by a script file given on the command line:
+//
+//   # comment
+//   press 1000          button held for 100ms starting at t = 1000ms
+//   serial 4000 p       byte 'p' arrives on the serial port at t = 4000ms
+//   sample 512 -64 16384 next raw LIS3DH output (left justified XYZ)
+//   quit 20000          stop the simulation at t = 20000ms
+//   eeprom keys.bin     EEPROM image, loaded at start and saved at exit
+//                       (erased, all 0xFF, if the file does not exist yet)
+//
+// samples are handed out in order, one per output read in bypass mode or
+// one per output data rate tick while the FIFO is streaming or the
+// activity event is enabled. The LIS3DH model covers the registers the
+// firmware uses: CTRL_REG1 (ODR), CTRL_REG2 (high pass for INT1),
+// CTRL_REG3 (watermark or activity on INT1), CTRL_REG5 (FIFO enable,
+// INT1 latch), REFERENCE, FIFO_CTRL_REG, FIFO_SRC_REG, INT1_CFG/SRC/THS/
+// DURATION (high events, OR combined) and the auto incrementing
+// OUT_X_L..OUT_Z_H burst.
+#ifndef ARDUINO
+
+#include "hal.h"
+#include "lis3dh.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <deque>
+#include <utility>
+#include <vector>
+
+void setup();
+void loop();
+
+#define PRESS_MS 100          // how long a scripted press holds the button
+#define QUIT_AFTER_MS 5000    // default run time after the last press
+
+struct sample {
+  int16_t x, y, z;
+};
+
+// virtual time
+static uint64_t nowUs = 0;
+
+// script
+static std::vector<uint32_t> presses;
+static std::deque<std::pair<uint32_t, char> > serialIn;
+static std::deque<sample> script;
+#ifndef PIO_UNIT_TESTING
+static uint32_t quitMs = 0;
+static char eepromPath[96] = "";
+#endif
+
+// eeprom
+static uint8_t eeprom[HAL_EEPROM_SIZE];
+static uint32_t eepromWrites = 0;
+
+// timer
+static bool timerRunning = false;
+static uint64_t timerPeriodUs = 0;
+static uint64_t timerNextUs = 0;
+
+// accelerometer model
+static uint8_t regs[0x40];
+static std::deque<sample> fifo;
+static sample output = {0, 0, 0};
+static uint64_t odrNextUs = 0;
+static bool intEnabled = false;
+static bool intLevel = false;
+static int32_t highPassRef[3];   // what the INT1 high pass filter removes
+static sample latest = {0, 0, 0};  // last sample taken at the data rate
+static uint8_t eventTicks = 0;   // samples in a row over the threshold
+
+// button edge interrupt
+static bool buttonIntEnabled = false;
+static bool buttonLevel = false;
+
+// set while an application hook runs
+static bool inInterrupt = false;
+
+// SPI frame state
+static uint8_t spiPos = 0;
+static uint8_t spiAddr = 0;
+static bool spiRead = false;
+static bool spiIncr = false;
+
+// -------------- ACCELEROMETER MODEL -------------- //
+static uint16_t accelOdrHz() {
+  static const uint16_t rates[16] = {0, 1, 10, 25, 50, 100, 200, 400,
+                                     0, 0, 0, 0, 0, 0, 0, 0};
+  return rates[regs[LIS3DH_CTRL_REG1] >> 4];
+}
+
+static bool fifoStreaming() {
+  return (regs[LIS3DH_CTRL_REG5] & LIS3DH_FIFO_EN) &&
+         (regs[LIS3DH_FIFO_CTRL_REG] & 0xC0) == LIS3DH_FIFO_STREAM;
+}
+
+static bool activityEnabled() {
+  return regs[LIS3DH_INT1_CFG] & (LIS3DH_XHIE | LIS3DH_YHIE | LIS3DH_ZHIE);
+}
+
+static sample nextScripted() {
+  if (script.empty()) return output;
+  sample s = script.front();
+  script.pop_front();
+  return s;
+}
+
+static uint8_t fifoSource() {
+  uint8_t count = fifo.size() > LIS3DH_FIFO_FSS ? LIS3DH_FIFO_FSS : fifo.size();
+  uint8_t src = count;
+  if (fifo.size() >= (size_t)(regs[LIS3DH_FIFO_CTRL_REG] & LIS3DH_FIFO_FSS)) {
+    src |= LIS3DH_FIFO_WTM;
+  }
+  if (fifo.size() == LIS3DH_FIFO_DEPTH) src |= LIS3DH_FIFO_OVRN;
+  if (fifo.empty()) src |= 0x20;
+  return src;
+}
+
+static void accelWriteReg(uint8_t reg, uint8_t value) {
+  regs[reg] = value;
+  // bypass mode (or disabling the FIFO) drops its content
+  if ((reg == LIS3DH_FIFO_CTRL_REG || reg == LIS3DH_CTRL_REG5) && !fifoStreaming()) {
+    fifo.clear();
+  }
+}
+
+static uint8_t accelReadReg(uint8_t reg) {
+  // reading REFERENCE sets the high pass output to zero (the sensor sees
+  // the next scripted sample by now, nothing may have consumed the ones
+  // before it)
+  if (reg == LIS3DH_REFERENCE) {
+    const sample &now = script.empty() ? latest : script.front();
+    highPassRef[0] = now.x;
+    highPassRef[1] = now.y;
+    highPassRef[2] = now.z;
+  }
+  // reading INT1_SRC releases a latched event
+  if (reg == LIS3DH_INT1_SRC) {
+    uint8_t src = regs[reg];
+    regs[reg] = 0;
+    return src;
+  }
+
+  if (reg == LIS3DH_OUT_X_L) {
+    if (regs[LIS3DH_CTRL_REG5] & LIS3DH_FIFO_EN) {
+      if (!fifo.empty()) {
+        output = fifo.front();
+        fifo.pop_front();
+      }
+    } else {
+      output = nextScripted();
+    }
+  }
+
+  switch (reg) {
+    case LIS3DH_OUT_X_L:     return output.x & 0xFF;
+    case LIS3DH_OUT_X_L + 1: return (uint16_t)output.x >> 8;
+    case LIS3DH_OUT_X_L + 2: return output.y & 0xFF;
+    case LIS3DH_OUT_X_L + 3: return (uint16_t)output.y >> 8;
+    case LIS3DH_OUT_X_L + 4: return output.z & 0xFF;
+    case LIS3DH_OUT_X_L + 5: return (uint16_t)output.z >> 8;
+    case LIS3DH_FIFO_SRC_REG: return fifoSource();
+    default: return regs[reg];
+  }
+}
+
+// INT1 follows the watermark and activity flags routed to it, the MCU
+// sees the rising edge
+static void accelUpdateInt() {
+  bool level = ((regs[LIS3DH_CTRL_REG3] & LIS3DH_I1_WTM) && fifoStreaming() &&
+                (fifoSource() & LIS3DH_FIFO_WTM)) ||
+               ((regs[LIS3DH_CTRL_REG3] & LIS3DH_I1_IA1) &&
+                (regs[LIS3DH_INT1_SRC] & LIS3DH_IA));
+  bool rising = level && !intLevel;
+  intLevel = level;
+  if (rising && intEnabled && !inInterrupt) {
+    inInterrupt = true;
+    onAccelInterrupt();
+    inInterrupt = false;
+    accelUpdateInt();
+  }
+}
+
+// activity: an enabled axis beyond the threshold for more than
+// INT1_DURATION samples. The high pass filter is modelled as the distance
+// from a reference that follows the signal by 1/8 per sample (about 2Hz
+// at 100Hz), gravity included it starts out far away until REFERENCE is
+// read.
+static void accelActivity(const sample &s) {
+  int32_t v[3] = {s.x, s.y, s.z};
+  // threshold in mg, output counts are 16 per mg (left justified)
+  int32_t ths = (int32_t)(regs[LIS3DH_INT1_THS] & 0x7F) * LIS3DH_THS_MG * 16;
+  uint8_t events = 0;
+  for (uint8_t a = 0; a < 3; a++) {
+    int32_t d = v[a];
+    if (regs[LIS3DH_CTRL_REG2] & LIS3DH_HPIS1) {
+      d -= highPassRef[a];
+      highPassRef[a] += d / 8;
+    }
+    uint8_t high = LIS3DH_XHIE << (2 * a);
+    if ((regs[LIS3DH_INT1_CFG] & high) && (d > ths || d < -ths)) events |= high;
+  }
+
+  if (!events) {
+    eventTicks = 0;
+  } else if (eventTicks < 255) {
+    eventTicks++;
+  }
+
+  if (events && eventTicks > regs[LIS3DH_INT1_DURATION]) {
+    regs[LIS3DH_INT1_SRC] = LIS3DH_IA | events;
+  } else if (!(regs[LIS3DH_CTRL_REG5] & LIS3DH_LIR_INT1)) {
+    regs[LIS3DH_INT1_SRC] = 0;
+  }
+}
+
+static void accelTick() {
+  bool streaming = fifoStreaming();
+  if (!streaming && !activityEnabled()) return;
+
+  latest = nextScripted();
+  if (streaming) {
+    if (fifo.size() == LIS3DH_FIFO_DEPTH) fifo.pop_front();
+    fifo.push_back(latest);
+  } else {
+    output = latest;
+  }
+  if (activityEnabled()) accelActivity(latest);
+}
+
+// -------------- VIRTUAL TIME -------------- //
+// runs every timer and sensor event up to now + us, in order
+static void advance(uint64_t us) {
+  uint64_t end = nowUs + us;
+  for (;;) {
+    uint16_t odr = accelOdrHz();
+    if (odr && odrNextUs <= nowUs) odrNextUs = nowUs + 1000000 / odr;
+
+    uint64_t next = end;
+    if (timerRunning && timerNextUs < next) next = timerNextUs;
+    if (odr && odrNextUs < next) next = odrNextUs;
+    nowUs = next;
+
+    if (odr && nowUs == odrNextUs) {
+      accelTick();
+      odrNextUs += 1000000 / odr;
+      accelUpdateInt();
+    }
+    if (timerRunning && nowUs == timerNextUs) {
+      timerNextUs += timerPeriodUs;
+      inInterrupt = true;
+      onSampleTimer();
+      inInterrupt = false;
+    }
+    if (nowUs >= end) break;
+  }
+
+  // the button only changes on whole milliseconds
+  bool level = halButtonPressed();
+  if (level && !buttonLevel && buttonIntEnabled && !inInterrupt) {
+    inInterrupt = true;
+    onButtonEdge();
+    inInterrupt = false;
+  }
+  buttonLevel = level;
+}
+
+// -------------- SPI -------------- //
+void halSpiBegin(uint32_t hz) {
+  (void)hz;
+}
+
+void halSpiSelect() {
+  spiPos = 0;
+}
+
+void halSpiDeselect() {
+  accelUpdateInt();
+}
+
+uint8_t halSpiTransfer(uint8_t out) {
+  if (spiPos++ == 0) {
+    spiAddr = out & 0x3F;
+    spiRead = out & LIS3DH_READ;
+    spiIncr = out & LIS3DH_INCR;
+    return 0xFF;
+  }
+
+  uint8_t in = 0;
+  if (spiRead) {
+    in = accelReadReg(spiAddr);
+  } else {
+    accelWriteReg(spiAddr, out);
+  }
+
+  if (spiIncr) {
+    spiAddr = (spiAddr + 1) & 0x3F;
+    // with the FIFO enabled the output registers wrap back to OUT_X_L
+    if ((regs[LIS3DH_CTRL_REG5] & LIS3DH_FIFO_EN) && spiAddr == LIS3DH_OUT_X_L + 6) {
+      spiAddr = LIS3DH_OUT_X_L;
+    }
+  }
+  return in;
+}
+
+void halSpiRead(uint8_t *buf, size_t len) {
+  while (len--) *buf++ = halSpiTransfer(0x00);
+}
+
+// -------------- GPIO -------------- //
+void halButtonBegin() {}
+
+bool halButtonPressed() {
+  uint32_t ms = halMillis();
+  for (size_t i = 0; i < presses.size(); i++) {
+    if (ms >= presses[i] && ms < presses[i] + PRESS_MS) return true;
+  }
+  return false;
+}
+
+void halButtonIntEnable() {
+  buttonIntEnabled = true;
+}
+
+void halButtonIntDisable() {
+  buttonIntEnabled = false;
+}
+
+void halAccelIntBegin() {}
+
+void halAccelIntEnable() {
+  intEnabled = true;
+}
+
+void halAccelIntDisable() {
+  intEnabled = false;
+}
+
+// -------------- TIMER -------------- //
+void halTimerStart(uint16_t hz) {
+  timerPeriodUs = 1000000 / hz;
+  timerNextUs = nowUs + timerPeriodUs;
+  timerRunning = true;
+}
+
+void halTimerStop() {
+  timerRunning = false;
+}
+
+uint32_t halMillis() {
+  return nowUs / 1000;
+}
+
+// every clock read outside an interrupt costs a microsecond, so busy waits
+// on micros() (like colorlib::canShow()) make progress
+uint32_t halMicros() {
+  if (!inInterrupt) advance(1);
+  return nowUs;
+}
+
+void halDelay(uint32_t ms) {
+  advance((uint64_t)ms * 1000);
+}
+
+void halInterruptsOff() {}
+
+void halInterruptsOn() {}
+
+uint8_t halIrqSave() {
+  return 0;
+}
+
+void halIrqRestore(uint8_t state) {
+  (void)state;
+}
+
+// the simulation advances a millisecond per loop() anyway
+void halIdle() {}
+
+// real time, so host profiling measures the code and not the simulation
+void halCycleBegin() {}
+
+uint32_t halCycleCount() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+// -------------- EEPROM -------------- //
+uint8_t halEepromRead(uint16_t addr) {
+  return addr < HAL_EEPROM_SIZE ? eeprom[addr] : 0xFF;
+}
+
+void halEepromWrite(uint16_t addr, uint8_t value) {
+  if (addr < HAL_EEPROM_SIZE && eeprom[addr] != value) {
+    eeprom[addr] = value;
+    eepromWrites++;
+  }
+}
+
+// writes take no time on the host
+bool halEepromReady() {
+  return true;
+}
+
+// the unit tests (pio test -e native) bring their own main()
+#ifndef PIO_UNIT_TESTING
+static void eepromLoad() {
+  memset(eeprom, 0xFF, sizeof(eeprom));
+  FILE *f = eepromPath[0] ? fopen(eepromPath, "rb") : NULL;
+  if (f) {
+    if (fread(eeprom, 1, sizeof(eeprom), f) != sizeof(eeprom)) {
+      memset(eeprom, 0xFF, sizeof(eeprom));
+    }
+    fclose(f);
+  }
+}
+
+static void eepromSave() {
+  if (!eepromPath[0]) return;
+  FILE *f = fopen(eepromPath, "wb");
+  if (f) {
+    fwrite(eeprom, 1, sizeof(eeprom), f);
+    fclose(f);
+  }
+  fprintf(stderr, "eeprom cells written: %u\n", (unsigned)eepromWrites);
+}
+#endif
+
+// -------------- SERIAL -------------- //
+void halSerialBegin(uint32_t baud) {
+  (void)baud;
+}
+
+void halPrint(const char *s) {
+  fputs(s, stdout);
+}
+
+void halPrint(long v) {
+  printf("%ld", v);
+}
+
+void halPrintln(const char *s) {
+  puts(s);
+}
+
+void halPrintln(long v) {
+  printf("%ld\n", v);
+}
+
+void halSerialWrite(const uint8_t *buf, size_t len) {
+  fwrite(buf, 1, len, stdout);
+}
+
+int halSerialRead() {
+  if (serialIn.empty() || serialIn.front().first > halMillis()) return -1;
+  char c = serialIn.front().second;
+  serialIn.pop_front();
+  return (uint8_t)c;
+}
+
+// -------------- SCRIPT -------------- //
+#ifndef PIO_UNIT_TESTING
+static bool loadScript(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) return false;
+
+  char line[128];
+  while (fgets(line, sizeof(line), f)) {
+    int x, y, z;
+    unsigned ms;
+    char c;
+    if (sscanf(line, " press %u", &ms) == 1) {
+      presses.push_back(ms);
+    } else if (sscanf(line, " sample %d %d %d", &x, &y, &z) == 3) {
+      sample s = {(int16_t)x, (int16_t)y, (int16_t)z};
+      script.push_back(s);
+    } else if (sscanf(line, " serial %u %c", &ms, &c) == 2) {
+      serialIn.push_back(std::make_pair((uint32_t)ms, c));
+    } else if (sscanf(line, " quit %u", &ms) == 1) {
+      quitMs = ms;
+    } else if (sscanf(line, " eeprom %95s", eepromPath) == 1) {
+      // path stored by sscanf
+    }
+  }
+  fclose(f);
+
+  if (quitMs == 0) {
+    for (size_t i = 0; i < presses.size(); i++) {
+      if (presses[i] + QUIT_AFTER_MS > quitMs) quitMs = presses[i] + QUIT_AFTER_MS;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2 || !loadScript(argv[1])) {
+    fprintf(stderr, "usage: %s <script>\n", argv[0]);
+    return 1;
+  }
+
+  eepromLoad();
+  setup();
+  while (halMillis() < quitMs) {
+    loop();
+    advance(1000);
+  }
+  eepromSave();
+  return 0;
+}
+#endif
+
+#endif
@@ -0,0 +1,175 @@
+#include "keystore.h"
+#include "hal.h"
+
+#define EMPTY 0xFF
+
+#if KEYSTORE_SLOTS * KEYSTORE_SLOT_BYTES > HAL_EEPROM_SIZE
+#error "key store does not fit in the EEPROM"
+#endif
+
+static uint16_t slotAddr(uint8_t slot) {
+  return (uint16_t)slot * KEYSTORE_SLOT_BYTES;
+}
+
+static uint16_t crc16(uint16_t crc, uint8_t data) {
+  crc ^= (uint16_t)data << 8;
+  for (uint8_t b = 0; b < 8; b++) {
+    crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+// walks the payload of a slot, copying it into samples when given, and
+// returns the stored length if the header matches (any length for
+// KEYSTORE_ANY_LENGTH) and the CRC checks out, 0 otherwise
+static uint8_t readSlot(uint8_t slot, uint8_t rate, uint8_t length,
+                        packedSample *samples) {
+  if (slot >= KEYSTORE_SLOTS || length > KEYSTORE_MAX_LENGTH) {
+    return 0;
+  }
+
+  uint16_t addr = slotAddr(slot);
+  uint8_t header[KEYSTORE_HEADER];
+  for (uint8_t i = 0; i < KEYSTORE_HEADER; i++) {
+    header[i] = halEepromRead(addr++);
+  }
+  if (length == KEYSTORE_ANY_LENGTH) length = header[2];
+  if (header[0] != KEYSTORE_VERSION || header[1] != rate || header[2] != length ||
+      length == 0 || length > KEYSTORE_MAX_LENGTH) {
+    return 0;
+  }
+
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < 4; i++) {
+    crc = crc16(crc, header[i]);
+  }
+
+  uint8_t *p = (uint8_t *)samples;
+  uint16_t bytes = (uint16_t)length * sizeof(packedSample);
+  for (uint16_t i = 0; i < bytes; i++) {
+    uint8_t b = halEepromRead(addr++);
+    crc = crc16(crc, b);
+    if (p) p[i] = b;
+  }
+
+  return crc == (uint16_t)(header[4] | (uint16_t)header[5] << 8) ? length : 0;
+}
+
+bool keystoreValid(uint8_t slot, uint8_t rate, uint8_t length) {
+  return readSlot(slot, rate, length, 0);
+}
+
+uint8_t keystoreLength(uint8_t slot, uint8_t rate) {
+  return readSlot(slot, rate, KEYSTORE_ANY_LENGTH, 0);
+}
+
+bool keystoreLoad(uint8_t slot, uint8_t rate, uint8_t length,
+                  packedSample *samples) {
+  return readSlot(slot, rate, length, samples);
+}
+
+packedSample keystoreSample(uint8_t slot, uint8_t i) {
+  uint16_t addr = slotAddr(slot) + KEYSTORE_HEADER + (uint16_t)i * sizeof(packedSample);
+  packedSample s;
+  s.x = (int8_t)halEepromRead(addr);
+  s.y = (int8_t)halEepromRead(addr + 1);
+  s.z = (int8_t)halEepromRead(addr + 2);
+  return s;
+}
+
+uint8_t keystoreCount(uint8_t rate, uint8_t length) {
+  uint8_t count = 0;
+  for (uint8_t s = 0; s < KEYSTORE_SLOTS; s++) {
+    if (keystoreValid(s, rate, length)) count++;
+  }
+  return count;
+}
+
+// empty slots first, then the one with the oldest sequence number
+static uint8_t pickSlot(uint8_t *sequence) {
+  uint8_t slot = 0;
+  bool haveNewest = false;
+  uint8_t newest = 0;
+  int8_t oldestAge = -128;
+  for (uint8_t s = 0; s < KEYSTORE_SLOTS; s++) {
+    if (halEepromRead(slotAddr(s)) != KEYSTORE_VERSION) continue;
+    uint8_t seq = halEepromRead(slotAddr(s) + 3);
+    if (!haveNewest || (int8_t)(seq - newest) > 0) newest = seq;
+    haveNewest = true;
+  }
+
+  for (uint8_t s = 0; s < KEYSTORE_SLOTS; s++) {
+    if (halEepromRead(slotAddr(s)) != KEYSTORE_VERSION) {
+      slot = s;
+      break;
+    }
+    // age relative to the newest, the sequence wraps
+    int8_t age = (int8_t)(newest - halEepromRead(slotAddr(s) + 3));
+    if (age > oldestAge) {
+      oldestAge = age;
+      slot = s;
+    }
+  }
+  *sequence = newest + 1;
+  return slot;
+}
+
+int8_t keystoreSaveBegin(keystoreWriter &w, uint8_t rate, uint8_t length,
+                         const packedSample *samples) {
+  w.slot = -1;
+  if (length == 0 || length > KEYSTORE_MAX_LENGTH) return -1;
+
+  uint8_t sequence;
+  w.slot = pickSlot(&sequence);
+  w.base = slotAddr(w.slot);
+  w.samples = samples;
+  w.bytes = (uint16_t)length * sizeof(packedSample);
+  w.next = 0;
+
+  w.header[0] = KEYSTORE_VERSION;
+  w.header[1] = rate;
+  w.header[2] = length;
+  w.header[3] = sequence;
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < 4; i++) {
+    crc = crc16(crc, w.header[i]);
+  }
+  const uint8_t *p = (const uint8_t *)samples;
+  for (uint16_t i = 0; i < w.bytes; i++) {
+    crc = crc16(crc, p[i]);
+  }
+  w.header[4] = crc & 0xFF;
+  w.header[5] = crc >> 8;
+  return w.slot;
+}
+
+// step 0 empties the version byte, so the slot reads as empty until the
+// last step puts it back; the payload and header bytes 5..1 go in between
+bool keystoreSaveStep(keystoreWriter &w) {
+  uint16_t n = w.next++;
+  if (n == 0) {
+    halEepromWrite(w.base, EMPTY);
+  } else if (n <= w.bytes) {
+    halEepromWrite(w.base + KEYSTORE_HEADER + n - 1, ((const uint8_t *)w.samples)[n - 1]);
+  } else if (n < w.bytes + KEYSTORE_HEADER) {
+    uint8_t i = KEYSTORE_HEADER - (n - w.bytes);
+    halEepromWrite(w.base + i, w.header[i]);
+  } else {
+    halEepromWrite(w.base, KEYSTORE_VERSION);
+    return true;
+  }
+  return false;
+}
+
+int8_t keystoreSave(uint8_t rate, uint8_t length, const packedSample *samples) {
+  keystoreWriter w;
+  if (keystoreSaveBegin(w, rate, length, samples) < 0) return -1;
+  while (!keystoreSaveStep(w)) {}
+  return w.slot;
+}
+
+void keystoreErase() {
+  for (uint8_t s = 0; s < KEYSTORE_SLOTS; s++) {
+    halEepromWrite(slotAddr(s), EMPTY);
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef KEYSTORE_H
+#define KEYSTORE_H
+
+// enrolled keys in EEPROM, KEYSTORE_SLOTS slots of KEYSTORE_SLOT_BYTES:
+//
+//   byte 0     format version (KEYSTORE_VERSION, 0xFF = empty slot)
+//   byte 1     sample rate in Hz
+//   byte 2     length in samples
+//   byte 3     write sequence number, +1 per save (oldest slot is reused)
+//   byte 4..5  CRC-16/CCITT over bytes 0..3 and the payload, little endian
+//   byte 6..   payload, the packed samples as they are in RAM
+//              (interleaved x, y, z int8, see capture.h)
+//
+// saves only write bytes that changed and the version byte last, so an
+// interrupted save leaves an empty or CRC failing slot. Loading a slot is
+// a single pass over at most KEYSTORE_SLOT_BYTES bytes.
+
+#include <stdint.h>
+#include <capture.h>
+
+#define KEYSTORE_VERSION 2       // 1 stored int16 + int8 delta axes
+#define KEYSTORE_SLOTS 4
+#define KEYSTORE_MAX_LENGTH 75
+#define KEYSTORE_HEADER 6
+#define KEYSTORE_SLOT_BYTES (KEYSTORE_HEADER + KEYSTORE_MAX_LENGTH * 3)  // 3 byte packedSample
+#define KEYSTORE_ANY_LENGTH 0    // length argument matching every stored length
+
+// true if the slot holds a key with this rate and length and a good CRC
+bool keystoreValid(uint8_t slot, uint8_t rate, uint8_t length);
+
+// length of the key in a slot (motion triggered keys vary), 0 if the slot
+// holds no valid key with this rate
+uint8_t keystoreLength(uint8_t slot, uint8_t rate);
+
+// reads a slot into samples (length of them), false if not valid
+// (the buffer may have been written anyway)
+bool keystoreLoad(uint8_t slot, uint8_t rate, uint8_t length,
+                  packedSample *samples);
+
+// sample i of a slot, read straight from the EEPROM without a CRC check
+// (for slots keystoreValid() accepted), cheap enough for an interrupt
+packedSample keystoreSample(uint8_t slot, uint8_t i);
+
+// saves a key into an empty slot, or over the oldest one if all are in
+// use, returns the slot or -1 if length is out of range
+int8_t keystoreSave(uint8_t rate, uint8_t length, const packedSample *samples);
+
+// the same save one EEPROM byte at a time, for callers that cannot wait
+// out every cell write (3.4ms each on the ATmega32u4)
+struct keystoreWriter {
+    const packedSample *samples;        // left unchanged until the save is done
+    uint8_t header[KEYSTORE_HEADER];    // CRC filled in up front
+    uint16_t base;                      // slot address
+    uint16_t bytes;                     // payload bytes
+    uint16_t next;                      // write step, see keystoreSaveStep()
+    int8_t slot;
+};
+
+// picks the slot like keystoreSave(), returns it or -1 if length is out of
+// range (nothing to step then)
+int8_t keystoreSaveBegin(keystoreWriter &w, uint8_t rate, uint8_t length,
+                         const packedSample *samples);
+
+// writes the next byte, returns true once the slot is complete
+bool keystoreSaveStep(keystoreWriter &w);
+
+// number of valid keys with this rate and length
+uint8_t keystoreCount(uint8_t rate, uint8_t length);
+
+// marks every slot empty
+void keystoreErase();
+
+#endif
@@ -0,0 +1,74 @@
+#include "lis3dh.h"
+#include "hal.h"
+
+// shadowed registers in shadow[] order, with their power on values
+static const uint8_t shadowRegs[LIS3DH_SHADOWS] = {
+  LIS3DH_CTRL_REG1, LIS3DH_CTRL_REG2, LIS3DH_CTRL_REG3,
+  LIS3DH_CTRL_REG4, LIS3DH_CTRL_REG5, LIS3DH_CTRL_REG6,
+  LIS3DH_FIFO_CTRL_REG, LIS3DH_INT1_CFG, LIS3DH_INT1_THS, LIS3DH_INT1_DURATION,
+};
+
+#define CTRL_REG1_RESET LIS3DH_XYZ_EN  // power down, all axes on
+
+void Lis3dh::begin(uint32_t clockHz) {
+  halSpiBegin(clockHz);
+  for (uint8_t i = 0; i < LIS3DH_SHADOWS; i++) {
+    write(shadowRegs[i], shadowRegs[i] == LIS3DH_CTRL_REG1 ? CTRL_REG1_RESET : 0);
+  }
+}
+
+// CTRL_REG1..6 are one run of addresses, the rest are looked up
+int8_t Lis3dh::shadowIndex(uint8_t reg) {
+  if (reg >= LIS3DH_CTRL_REG1 && reg <= LIS3DH_CTRL_REG6) return reg - LIS3DH_CTRL_REG1;
+  for (uint8_t i = LIS3DH_CTRL_REG6 - LIS3DH_CTRL_REG1 + 1; i < LIS3DH_SHADOWS; i++) {
+    if (shadowRegs[i] == reg) return i;
+  }
+  return -1;
+}
+
+void Lis3dh::write(uint8_t reg, uint8_t value) {
+  int8_t i = shadowIndex(reg);
+  if (i >= 0) shadow[i] = value;
+
+  halSpiSelect();
+  halSpiTransfer(reg);
+  halSpiTransfer(value);
+  halSpiDeselect();
+}
+
+uint8_t Lis3dh::read(uint8_t reg) {
+  halSpiSelect();
+  halSpiTransfer(reg | LIS3DH_READ);
+  uint8_t value = halSpiTransfer(0x00);
+  halSpiDeselect();
+  return value;
+}
+
+void Lis3dh::setBits(uint8_t reg, uint8_t bits) {
+  int8_t i = shadowIndex(reg);
+  write(reg, (i >= 0 ? shadow[i] : read(reg)) | bits);
+}
+
+void Lis3dh::clearBits(uint8_t reg, uint8_t bits) {
+  int8_t i = shadowIndex(reg);
+  write(reg, (i >= 0 ? shadow[i] : read(reg)) & ~bits);
+}
+
+void Lis3dh::readBurst(uint8_t reg, uint8_t *buf, uint8_t len) {
+  burstBegin(reg);
+  burstRead(buf, len);
+  burstEnd();
+}
+
+void Lis3dh::burstBegin(uint8_t reg) {
+  halSpiSelect();
+  halSpiTransfer(reg | LIS3DH_READ | LIS3DH_INCR);
+}
+
+void Lis3dh::burstRead(uint8_t *buf, uint8_t len) {
+  halSpiRead(buf, len);
+}
+
+void Lis3dh::burstEnd() {
+  halSpiDeselect();
+}
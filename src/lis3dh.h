@@ -0,0 +1,120 @@
+#ifndef LIS3DH_H
+#define LIS3DH_H
+
+#include <stdint.h>
+
+// LIS3DH register map (only what the project uses)
+#define LIS3DH_CTRL_REG1     0x20  // ODR, low power, axis enable
+#define LIS3DH_CTRL_REG2     0x21  // high pass filter
+#define LIS3DH_CTRL_REG3     0x22  // INT1 routing
+#define LIS3DH_CTRL_REG4     0x23  // full scale, high resolution
+#define LIS3DH_CTRL_REG5     0x24  // FIFO enable, latch
+#define LIS3DH_CTRL_REG6     0x25  // INT2 routing, interrupt polarity
+#define LIS3DH_REFERENCE     0x26  // reading it resets the high pass filter
+#define LIS3DH_OUT_X_L       0x28  // first output register (X, Y, Z follow)
+#define LIS3DH_FIFO_CTRL_REG 0x2E  // FIFO mode and watermark level
+#define LIS3DH_FIFO_SRC_REG  0x2F  // FIFO status and sample count
+#define LIS3DH_INT1_CFG      0x30  // INT1 function event enables
+#define LIS3DH_INT1_SRC      0x31  // INT1 function status, read clears a latch
+#define LIS3DH_INT1_THS      0x32  // INT1 threshold
+#define LIS3DH_INT1_DURATION 0x33  // INT1 minimum event length, 1/ODR steps
+
+// CTRL_REG1 output data rate (bits 7:4) and axis enables
+#define LIS3DH_ODR_10HZ      0x20
+#define LIS3DH_ODR_25HZ      0x30
+#define LIS3DH_ODR_50HZ      0x40
+#define LIS3DH_ODR_100HZ     0x50
+#define LIS3DH_ODR_200HZ     0x60
+#define LIS3DH_ODR_400HZ     0x70
+#define LIS3DH_XYZ_EN        0x07
+
+// ODR bits for a rate in Hz, 0 if the LIS3DH has no such rate
+#define LIS3DH_ODR(hz) ((hz) == 10  ? LIS3DH_ODR_10HZ  : \
+                        (hz) == 25  ? LIS3DH_ODR_25HZ  : \
+                        (hz) == 50  ? LIS3DH_ODR_50HZ  : \
+                        (hz) == 100 ? LIS3DH_ODR_100HZ : \
+                        (hz) == 200 ? LIS3DH_ODR_200HZ : \
+                        (hz) == 400 ? LIS3DH_ODR_400HZ : 0)
+
+// SPI address byte flags
+#define LIS3DH_READ          0x80  // read (1) / write (0)
+#define LIS3DH_INCR          0x40  // auto increment address
+
+// CTRL_REG2 bits
+#define LIS3DH_HPIS1         0x01  // high pass filtered data for the INT1 function
+
+// CTRL_REG4 bits
+#define LIS3DH_HR            0x08  // high resolution (12 bit) output
+
+// CTRL_REG3 bits
+#define LIS3DH_I1_IA1        0x40  // INT1 function (activity) on INT1
+#define LIS3DH_I1_WTM        0x04  // FIFO watermark on INT1
+
+// CTRL_REG5 bits
+#define LIS3DH_FIFO_EN       0x40  // FIFO enable
+#define LIS3DH_LIR_INT1      0x08  // latch INT1_SRC until it is read
+
+// INT1_CFG bits, OR combination of the high events = activity (wake-up)
+#define LIS3DH_XHIE          0x02
+#define LIS3DH_YHIE          0x08
+#define LIS3DH_ZHIE          0x20
+
+// INT1_SRC bits
+#define LIS3DH_IA            0x40  // an enabled event is active
+
+// INT1_THS step at +-2g full scale
+#define LIS3DH_THS_MG        16
+
+// FIFO_CTRL_REG modes (bits 7:6), watermark level in bits 4:0
+#define LIS3DH_FIFO_BYPASS   0x00
+#define LIS3DH_FIFO_STREAM   0x80
+
+// FIFO_SRC_REG bits
+#define LIS3DH_FIFO_WTM      0x80  // content at or above watermark
+#define LIS3DH_FIFO_OVRN     0x40  // all 32 slots full
+#define LIS3DH_FIFO_FSS      0x1F  // number of unread samples
+
+#define LIS3DH_FIFO_DEPTH    32
+
+// fastest SPI clock the part takes (the bus runs at the closest rate the
+// MCU can make at or below it, F_CPU / 2 on the AVR)
+#define LIS3DH_SPI_MAX_HZ    10000000UL
+
+#define LIS3DH_SAMPLE_BYTES  6     // OUT_X_L..OUT_Z_H
+
+// LIS3DH over SPI (through the HAL)
+// the driver is the only writer of the control registers, so it keeps a
+// shadow copy of each: changing a few bits is one write computed from
+// the shadow, never a read-modify-write over the bus. Bursts read
+// consecutive registers (auto increment) in one transaction, straight
+// into the caller's buffer.
+#define LIS3DH_SHADOWS       10    // CTRL_REG1..6, FIFO_CTRL_REG, INT1_CFG/THS/DURATION
+
+class Lis3dh {
+public:
+    // starts SPI at up to clockHz and puts every shadowed register (and
+    // its shadow) at the power on value, whatever a previous run left
+    void begin(uint32_t clockHz = LIS3DH_SPI_MAX_HZ);
+
+    void write(uint8_t reg, uint8_t value);
+    uint8_t read(uint8_t reg);
+
+    // bit changes, from the shadow (a register without one is read first)
+    void setBits(uint8_t reg, uint8_t bits);
+    void clearBits(uint8_t reg, uint8_t bits);
+
+    // len bytes from reg up in one transaction
+    void readBurst(uint8_t reg, uint8_t *buf, uint8_t len);
+
+    // the same transaction in pieces, for consuming a long burst (a FIFO
+    // drain) as it arrives: burstBegin(), any burstRead()s, burstEnd()
+    void burstBegin(uint8_t reg);
+    void burstRead(uint8_t *buf, uint8_t len);
+    void burstEnd();
+
+private:
+    static int8_t shadowIndex(uint8_t reg);
+    uint8_t shadow[LIS3DH_SHADOWS];
+};
+
+#endif
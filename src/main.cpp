@@ -11,209 +11,459 @@
 // 6) record 3 seconds and log values
 // 7) validate sequence
 // 8) show red light if failed, green if pass
-// 9) loop to step 4 if failed. Press button to reset to step 1 if pass. 
+// 9) loop to step 4 if failed (after 2 seconds, or right away on a press).
+//    Press button to reset to step 1 if pass. 
+// With MOTION_TRIGGER moving the board starts the recordings of steps 3
+// and 6 (no press needed in step 5), and holding it still ends them.
 
-#include <Arduino.h>
+#include <hal.h>       // board access (AVR or native host)
 #include <colorlib.h> // modified Adafruit_Neopixel library 
-#include <SPI.h>
+#include <staticstrip.h> // compile time colorlib strip
+#include <pipeline.h>  // capture filter, matcher and their settings
+// match the unlock sample by sample while it is recorded (fixed point rule)
+#define STREAM_MATCH (MATCHER == MATCHER_FIXED)
+#include <profile.h>   // hot path timing (-DPROFILE_ENABLED=1)
+#include <telemetry.h> // binary capture dumps
+#include <events.h>    // event queue for the state machine
+#include <sched.h>     // cooperative task scheduler
+#include <button.h>    // interrupt driven button
+#include <anim.h>      // LED animations
+#include <keystore.h>  // enrolled keys in EEPROM
 
-// constants
-#define SPI_CS 4           // Accelerometer SPI CS on PB4
-#define TIMER_COUNT 25*3   // 75 counts for 25Hz in 3sec
-#define WINDOW_SIZE 31     // moving average filter window size
+// constants (sampling and filter settings are in pipeline.h)
 #define NUM_PIXELS 10      // 10 neopixels on the board
-#define NEO_PIN 17         // pin for setting the neopixels
+#define NEO_PORT NEO_PORTB // neopixels on pin 17 = PB0
+#define NEO_BIT 0
+#define SERIAL_BAUD 1000000 // telemetry link speed
+
+// capture mode
+// 0 - Timer1 wakes up at 25Hz and reads one sample per interrupt
+// 1 - LIS3DH FIFO in stream mode, INT1 watermark interrupt drains a batch
+#define USE_FIFO 1
+#define FIFO_WATERMARK 25  // samples per batch (250ms at 100Hz)
+
+// capture start
+// 0 - a button press starts a TIMER_COUNT sample (3 second) recording
+// 1 - the LIS3DH activity interrupt starts it and inactivity ends it, so
+//     gestures vary in length (in ST_ARMED a press still starts one)
+#define MOTION_TRIGGER 0
+#define MOTION_THRESHOLD_MG 160 // high passed acceleration that starts a capture
+#define MOTION_DURATION 2       // for more than this many ACCEL_ODR samples
+#define QUIET_MG 24             // summed XYZ change per sample of a still board
+#define QUIET_SAMPLES 10        // still samples (400ms) that end a capture
+#define MOTION_MIN_SAMPLES 25   // but not before 1 second
+
+#if TIMER_COUNT > KEYSTORE_MAX_LENGTH
+#error "TIMER_COUNT samples do not fit in a key store slot"
+#endif
+
+// timing
+#define BUTTON_POLL_MS 10      // release debounce period
+#define FAIL_TIMEOUT_MS 2000   // red light before rearming
+#define EEPROM_POLL_MS 1       // key save steps, a cell write takes 3.4ms
 
 // neopixel LED setup
-colorlib strip(NUM_PIXELS, NEO_PIN);
-
-// control state = 0 waiting for first press of button 
-// control state = 1 read button press
-// control state = 2 read values from accelerometer 
-// control state = 3 wait for second button press
-// control state = 4 read second button press
-// control state = 5 read values for unlock from accelerometer
-// control state = 6 validate unlock
-// control state = 7 wait on button press to reset if passed
-volatile int controlState = 0;
+StaticStrip<NUM_PIXELS, NEO_PORT, NEO_BIT> strip;
+bool neoPending = false;        // rendered frame waiting for show()
+volatile bool neoSlot = false;  // a sample interrupt just finished
+
+// sentry states
+enum sentryState {
+  ST_IDLE,          // waiting for the button to record a key (BLUE)
+  ST_RECORD_KEY,    // recording the key for 3 seconds (ORANGE)
+  ST_SAVING,        // writing the key to the EEPROM (ORANGE)
+  ST_ARMED,         // waiting for the button to record an unlock (PURPLE)
+  ST_RECORD_UNLOCK, // recording the unlock for 3 seconds (ORANGE)
+  ST_VALIDATE,      // comparing unlock against key
+  ST_UNLOCKED,      // passed, button resets to ST_IDLE (GREEN)
+  ST_FAILED,        // failed, rearms after FAIL_TIMEOUT_MS (RED)
+  ST_COUNT
+};
+volatile uint8_t controlState = ST_IDLE;
 
 // timer variables
-volatile bool showValues = true;       // flag indicating timer activity
-volatile bool showValues2 = true;       // flag indicating timer activity
 volatile unsigned int timerCounter = 0;  // counter for timer 1 overflows
+int8_t stateTimeout = -1;                // scheduler task of the state timeout
+int8_t saveTask = -1;                    // scheduler task writing the key
+keystoreWriter keyWriter;                // key save in progress
+uint32_t recordStartMs = 0;              // halMillis() when recording started
+volatile uint16_t captureLength = TIMER_COUNT;  // samples in the last capture
+#if MOTION_TRIGGER
+volatile bool motionArmed = false;       // activity interrupt starts a capture
+volatile uint32_t motionUs = 0;          // halMicros() of that interrupt
+volatile uint32_t firstSampleUs = 0;     // halMicros() of the first sample
+uint8_t quietCount = 0;                  // still samples in a row
+#endif
 
 // function setups
 void accelerometerInit();
 void buttonInit();
 void neoInit();
-void setNeo(uint16_t r, uint16_t g, uint16_t b);
-void onButtonPress();
+void setNeo(uint8_t state);
+void animTask();
+void neoService();
+void neoShow();
+void postTimeout();
+void dispatch(uint8_t ev);
+void validateCapture();
+void startFailTimeout();
 void startRecording();
-void recordValues(int16_t *bufX, int16_t *bufY, int16_t *bufZ);
+void saveKey();
+void saveStep();
+void keySaved();
+void eraseKeys();
+void stopRecording(uint8_t ev);
+void checkRecording();
+void rejectUnlock();
+void keepSample(const packedSample &s);
+#if MOTION_TRIGGER
+void armMotion();
+void disarmMotion();
+void trackQuiet(int16_t x, int16_t y, int16_t z);
+#endif
+bool storeSample(int16_t x, int16_t y, int16_t z, packedSample *out);
+bool recordValues(packedSample *out);
+void readSample(int16_t *x, int16_t *y, int16_t *z);
+void recordBatch();
 bool validateSequence();
-void printBuffers();
-void printBuffersAll();
-
-// accelerometer recordings and windows
-int16_t X_key[TIMER_COUNT] = {0};
-int16_t Y_key[TIMER_COUNT] = {0};
-int16_t Z_key[TIMER_COUNT] = {0};
-int16_t X_unlock[TIMER_COUNT] = {0};
-int16_t Y_unlock[TIMER_COUNT] = {0};
-int16_t Z_unlock[TIMER_COUNT] = {0};
-int16_t X_window[WINDOW_SIZE] = {0};
-int16_t Y_window[WINDOW_SIZE] = {0};
-int16_t Z_window[WINDOW_SIZE] = {0};
+uint8_t screenKeys(uint8_t *order, uint16_t reject);
+void refreshKeyPrints();
+void sendBuffers(uint8_t length);
+#if STREAM_MATCH
+void beginUnlockMatch();
+void screenEarly();
+void matchUnlockSample(uint16_t i, const packedSample &s);
+void queueUnlockSample(const packedSample &s);
+void matchQueued();
+#else
+void sendUnlock();
+#endif
+
+// -------------- STATE MACHINE -------------- // 
+// LED color and animation shown while in each state
+static const uint32_t stateColor[ST_COUNT] = {
+  colorlib::Color(0, 0, 255),      // ST_IDLE          BLUE
+  colorlib::Color(255, 128, 0),    // ST_RECORD_KEY    ORANGE
+  colorlib::Color(255, 128, 0),    // ST_SAVING        ORANGE
+  colorlib::Color(127, 0, 255),    // ST_ARMED         PURPLE
+  colorlib::Color(255, 128, 0),    // ST_RECORD_UNLOCK ORANGE
+  colorlib::Color(255, 128, 0),    // ST_VALIDATE      ORANGE
+  colorlib::Color(0, 255, 0),      // ST_UNLOCKED      GREEN
+  colorlib::Color(255, 0, 0),      // ST_FAILED        RED
+};
+
+static const uint8_t stateEffect[ST_COUNT] = {
+  ANIM_BREATHE,    // ST_IDLE          ready
+  ANIM_PROGRESS,   // ST_RECORD_KEY    fills over the 3 seconds
+  ANIM_SOLID,      // ST_SAVING
+  ANIM_BREATHE,    // ST_ARMED         ready
+  ANIM_PROGRESS,   // ST_RECORD_UNLOCK
+  ANIM_SOLID,      // ST_VALIDATE
+  ANIM_SOLID,      // ST_UNLOCKED
+  ANIM_FLASH,      // ST_FAILED
+};
+
+// (state, event) -> next state, action runs after entering the next state
+struct transition {
+  uint8_t state;
+  uint8_t event;
+  uint8_t next;
+  void (*action)();
+};
+
+// (with MOTION_TRIGGER ST_RECORD_KEY waits for motion before sampling)
+static const transition transitions[] = {
+#if MOTION_TRIGGER
+  {ST_IDLE,          EV_BUTTON,        ST_RECORD_KEY,    armMotion},
+  {ST_RECORD_KEY,    EV_MOTION,        ST_RECORD_KEY,    startRecording},
+  {ST_ARMED,         EV_MOTION,        ST_RECORD_UNLOCK, startRecording},
+#else
+  {ST_IDLE,          EV_BUTTON,        ST_RECORD_KEY,    startRecording},
+#endif
+  {ST_RECORD_KEY,    EV_CAPTURE_DONE,  ST_SAVING,        saveKey},
+  {ST_SAVING,        EV_KEY_SAVED,     ST_ARMED,         keySaved},
+  {ST_ARMED,         EV_BUTTON,        ST_RECORD_UNLOCK, startRecording},
+  {ST_RECORD_UNLOCK, EV_CAPTURE_DONE,  ST_VALIDATE,      validateCapture},
+  {ST_RECORD_UNLOCK, EV_VALIDATE_FAIL, ST_FAILED,        rejectUnlock},
+  {ST_VALIDATE,      EV_VALIDATE_PASS, ST_UNLOCKED,      0},
+  {ST_VALIDATE,      EV_VALIDATE_FAIL, ST_FAILED,        startFailTimeout},
+#if MOTION_TRIGGER
+  {ST_FAILED,        EV_TIMEOUT,       ST_ARMED,         armMotion},
+#else
+  {ST_FAILED,        EV_TIMEOUT,       ST_ARMED,         0},
+#endif
+  {ST_FAILED,        EV_BUTTON,        ST_RECORD_UNLOCK, startRecording},
+  {ST_UNLOCKED,      EV_BUTTON,        ST_IDLE,          0},
+  // not while a capture, validation or save is under way
+  {ST_IDLE,          EV_ERASE,         ST_IDLE,          eraseKeys},
+  {ST_ARMED,         EV_ERASE,         ST_IDLE,          eraseKeys},
+  {ST_FAILED,        EV_ERASE,         ST_IDLE,          eraseKeys},
+  {ST_UNLOCKED,      EV_ERASE,         ST_IDLE,          eraseKeys},
+};
+
+// accelerometer recordings (packed, see capture.h) and windows
+// a streamed unlock is matched as it arrives and never stored
+packedSample keySamples[TIMER_COUNT];
+#if STREAM_MATCH
+matchStream slotMatch[KEYSTORE_SLOTS][MATCH_LAGS];  // per slot and lag
+matchCorr slotCorr[KEYSTORE_SLOTS];     // lag alignment of each slot
+uint8_t slotLength[KEYSTORE_SLOTS];     // key length of each slot
+uint8_t slotLive = 0;                   // slots whose key can still match
+#define MATCH_QUEUE 16                  // unlock samples waiting for loop(), power of 2
+packedSample matchQueue[MATCH_QUEUE];   // filled by the sampling interrupts
+volatile uint8_t queueHead = 0;         // unlock samples queued (mod 256)
+volatile uint8_t queueTail = 0;         // unlock samples matched (mod 256)
+#else
+packedSample unlockSamples[TIMER_COUNT];
+#endif
+volatile bool unlockRejected = false;   // streamed unlock can no longer pass
+volatile bool recording = false;        // between startRecording() and stopRecording()
+fingerprintAcc captureAcc;              // fingerprint of the capture so far
+fingerprint keyPrint[KEYSTORE_SLOTS];   // fingerprint of each enrolled key
+#if STREAM_MATCH
+fingerprintAcc earlyAcc;                // captureAcc after FP_EARLY_SAMPLES
+#endif
+sentryFilter filter;                    // raw sample conditioning
+Lis3dh accel;                           // accelerometer on SPI
 
 // -------------- TIMER INTERRUPT -------------- // 
 // timer interrupt on comparison
-ISR(TIMER1_COMPA_vect) {
-  //record the initial key values
-  if (controlState == 2) {
-    recordValues(X_key, Y_key, Z_key);
-    timerCounter++;
+void onSampleTimer() {
+  PROFILE_SCOPE(PROF_SAMPLE_ISR);
+
+  // record the key or the unlocking sequence
+  if (controlState == ST_RECORD_KEY || controlState == ST_RECORD_UNLOCK) {
+    packedSample s;
+    if (recordValues(&s)) keepSample(s);
   }
-  //record the unlocking sequence values seperately
-  if (controlState == 5) {
-    recordValues(X_unlock, Y_unlock, Z_unlock);
-    timerCounter++;
+
+  // stop and reset timer when it hits 75 (or the unlock is rejected)
+  checkRecording();
+
+  // the next compare is a whole sample period away, time for a frame
+  neoSlot = true;
+}
+
+// -------------- FIFO WATERMARK INTERRUPT -------------- // 
+// LIS3DH INT1 goes high once FIFO_WATERMARK samples are queued
+// (or, while armed for motion, on the activity event)
+void onAccelInterrupt() {
+  PROFILE_SCOPE(PROF_SAMPLE_ISR);
+
+#if MOTION_TRIGGER
+  if (motionArmed) {
+    motionArmed = false;
+    motionUs = halMicros();
+    halAccelIntDisable();
+    eventPost(EV_MOTION);
+    return;
   }
+#endif
 
-  // stop and reset timer when it hits 75
-  if (timerCounter == TIMER_COUNT) {
-    Serial.print("Timer ended: ");
-    Serial.println(timerCounter);
-    controlState++;
-    timerCounter = 0;
-    TCCR1B &= ~((1 << CS11) + (1 << CS10));   // Reset the buf index
+  if (controlState == ST_RECORD_KEY || controlState == ST_RECORD_UNLOCK) {
+    recordBatch();
   }
+
+  // stop once the buffers are full (or the unlock is rejected)
+  checkRecording();
+
+  neoSlot = true;
 }
 
 void setup() {
-  // set CS pin as OUTPUT
-  DDRB |= (1 << SPI_CS);
-
   // Initialize Serial and SPI
-  SPI.begin();
-  Serial.begin(9600);
+  accel.begin();
+  halSerialBegin(SERIAL_BAUD);
 
   // Initialize all necessary registers
+  PROFILE_INIT();
   neoInit();
   buttonInit();
   accelerometerInit();
-  Serial.println("All Systems Initialized");
+
+  // start in ST_IDLE showing BLUE, or ST_ARMED if keys survived the reset
+  refreshKeyPrints();
+  if (keystoreCount(SAMPLE_RATE, KEYSTORE_ANY_LENGTH)) {
+    controlState = ST_ARMED;
+  }
+  setNeo(controlState);
+#if MOTION_TRIGGER
+  if (controlState == ST_ARMED) {
+    armMotion();
+  }
+#endif
+  schedEvery(buttonService, BUTTON_POLL_MS);
+  schedEvery(animTask, ANIM_FRAME_MS);
+  halPrintln("All Systems Initialized");
 }
 
 void loop() {
-  // Serial.println(controlState);
-  // control state 0 - waiting on first button press
-  if (controlState == 0) {
-    // display BLUE on neopixels
-    setNeo(0, 0, 255);
-    
-    // read button input
-    onButtonPress();
+  // serial commands: 'p' dumps the profiling table, 'c' erases the keys
+  int cmd = halSerialRead();
+  if (cmd == 'p') {
+    PROFILE_DUMP();
+    halPrint("neo frames sent: ");
+    halPrint((long)strip.getFramesSent());
+    halPrint(" skipped: ");
+    halPrintln((long)strip.getFramesSkipped());
+  } else if (cmd == 'c') {
+    eventPost(EV_ERASE);
   }
 
-  // control state 1 -  read accel values 3 seconds
-  if (controlState == 1) { 
-    // display ORANGE on neopixels
-    setNeo(255, 128, 0);
-    // start recording values
-    startRecording();
-    // move to next state
-    controlState = 2;
+  // run due tasks, then hand every pending event to the state machine
+#if STREAM_MATCH
+  matchQueued();
+#endif
+  schedRun();
+  uint8_t ev;
+  while ((ev = eventGet()) != EV_NONE) {
+    dispatch(ev);
   }
+  neoService();
 
-  // control state 2 -  read accel values 3 seconds
-  if (controlState == 2) { 
-    // do nothing while waiting on accel values
-  }
+  // nothing to do until the next interrupt
+  halIdle();
+}
 
-  // control state 3 - waiting for second button press. 
-  if (controlState == 3) { 
-    // debugging
-    if (showValues) {
-      printBuffers();
-      showValues = false;
-    }
+// -------------- DISPATCH EVENT -------------- // 
+// looks up (state, event) in the transition table, events without an
+// entry are ignored (e.g. button presses while recording)
+void dispatch(uint8_t ev) {
+  for (uint8_t i = 0; i < sizeof(transitions) / sizeof(transitions[0]); i++) {
+    const transition &t = transitions[i];
+    if (t.state != controlState || t.event != ev) continue;
 
-    // display PURPLE on neopixels
-    setNeo(127, 0, 255);
+    // a state timeout only applies to the state that armed it
+    schedCancel(stateTimeout);
+    stateTimeout = -1;
 
-    //clear the window
-    for (int i = 0; i < WINDOW_SIZE; i++)
-    {
-      X_window[i] = 0;
-      Y_window[i] = 0;
-      Z_window[i] = 0;
+    controlState = t.next;
+    setNeo(t.next);
+    if (t.action) {
+      t.action();
     }
-
-    // read button input
-    onButtonPress();
+    return;
   }
+}
 
-  // control state 4 - reading unlock
-  if (controlState == 4) {
-    // display ORANGE on neopixels
-    setNeo(255, 128, 0);
-
-    // simulate recording values
-    startRecording();
-    
-    controlState++;
+// -------------- STATE ACTIONS -------------- // 
+// dumps the new key and starts enrolling it in the EEPROM key store. A
+// whole slot is about 230 cell writes, so saveStep() writes it from the
+// scheduler and EV_KEY_SAVED follows when it is done
+void saveKey() {
+  sendBuffers(captureLength);
+  if (keystoreSaveBegin(keyWriter, SAMPLE_RATE, captureLength, keySamples) < 0) {
+    eventPost(EV_KEY_SAVED);
+    return;
   }
-
-  // control state 5 -  read accel values 3 seconds
-  if (controlState == 5) { 
-    // do nothing while waiting on accel values
+  saveTask = schedEvery(saveStep, EEPROM_POLL_MS);
+  if (saveTask < 0) {
+    // no free task, write it in one go
+    while (!keystoreSaveStep(keyWriter)) {}
+    eventPost(EV_KEY_SAVED);
   }
+}
 
-  // control state 6 - confirm or deny if unlock was correct
-  if (controlState == 6) {
-    // print values
-    if (showValues2) {
-      printBuffersAll();
-      showValues2 = false;
+// scheduler task, writes while the EEPROM is idle (unchanged cells cost
+// nothing) and leaves each programming cycle to run in the background
+void saveStep() {
+  while (halEepromReady()) {
+    if (keystoreSaveStep(keyWriter)) {
+      schedCancel(saveTask);
+      saveTask = -1;
+      eventPost(EV_KEY_SAVED);
+      return;
     }
+  }
+}
 
-    if (validateSequence()) {
-      // passes
-      setNeo(0,255,0);      
-      controlState++;
-    }
-    else{
-      // fails and resets after 2 seconds
-      setNeo(255,0,0);
-      delay(2000);
-      controlState = 3;
-    }
+// the key is in its slot, its fingerprint joins the pre-screen
+void keySaved() {
+  halPrint("Key saved to slot ");
+  halPrintln((long)keyWriter.slot);
+  if (keyWriter.slot >= 0) {
+    fingerprintEnd(captureAcc, &keyPrint[keyWriter.slot]);
   }
+#if MOTION_TRIGGER
+  armMotion();
+#endif
+}
 
-  if (controlState == 7) {
-    // read button input
-    onButtonPress();
+void validateCapture() {
+#if !STREAM_MATCH
+  sendUnlock();
+#endif
+  if (validateSequence()) {
+    halPrintln("Sequence Passed");
+    eventPost(EV_VALIDATE_PASS);
+  } else {
+    halPrintln("Sequence Failed");
+    eventPost(EV_VALIDATE_FAIL);
   }
 }
 
+// no keys left, so back to ST_IDLE for a new one
+void eraseKeys() {
+  keystoreErase();
+  refreshKeyPrints();
+#if MOTION_TRIGGER
+  // the next key waits for the button again
+  halInterruptsOff();
+  disarmMotion();
+  halAccelIntDisable();
+  halInterruptsOn();
+#endif
+  halPrintln("Keys erased");
+}
+
+// the streamed unlock failed before the 3 seconds were up
+void rejectUnlock() {
+  halPrintln("Sequence Failed (early reject)");
+  startFailTimeout();
+}
+
+// red light for FAIL_TIMEOUT_MS, then back to ST_ARMED
+void startFailTimeout() {
+  stateTimeout = schedAfter(postTimeout, FAIL_TIMEOUT_MS);
+}
+
+void postTimeout() {
+  stateTimeout = -1;
+  eventPost(EV_TIMEOUT);
+}
+
 // -------------- INITIALIZE ACCELEROMETER -------------- //
 // sets up accelerometer by writing to control register 1
 void accelerometerInit() {
-  PORTB &= ~(1 << SPI_CS);    // pull down the accel SPI CS
-  SPI.transfer(0x20);         // LIS3DH control register 1
-  SPI.transfer(0b00110111);   // LIS3DH control register 1 settings
-  PORTB |= (1 << SPI_CS);     // release the accel SPI CS
-  PORTB &= ~(1 << SPI_CS);    // pull down the accel SPI CS
-  SPI.transfer(0x23);         // LIS3DH control register 4
-  SPI.transfer(0b00001000);   // LIS3DH control register 4 settings
-  PORTB |= (1 << SPI_CS);     // release the accel SPI CS
+  accel.write(LIS3DH_CTRL_REG1, LIS3DH_ODR(ACCEL_ODR) | LIS3DH_XYZ_EN);
+  accel.write(LIS3DH_CTRL_REG4, LIS3DH_HR);
+
+#if USE_FIFO
+  // FIFO stays in bypass until a recording starts
+  accel.setBits(LIS3DH_CTRL_REG5, LIS3DH_FIFO_EN);
+  accel.write(LIS3DH_FIFO_CTRL_REG, LIS3DH_FIFO_BYPASS);
+  accel.write(LIS3DH_CTRL_REG3, LIS3DH_I1_WTM);  // watermark on INT1
+#endif
+
+#if MOTION_TRIGGER
+  // activity (wake-up) event on high pass filtered data, latched in
+  // INT1_SRC until it is read; armMotion() enables it
+  accel.write(LIS3DH_CTRL_REG2, LIS3DH_HPIS1);
+  accel.write(LIS3DH_INT1_THS, MOTION_THRESHOLD_MG / LIS3DH_THS_MG);
+  accel.write(LIS3DH_INT1_DURATION, MOTION_DURATION);
+  accel.setBits(LIS3DH_CTRL_REG5, LIS3DH_LIR_INT1);
+#endif
+
+#if USE_FIFO || MOTION_TRIGGER
+  // INT1 edge interrupt, enabled per recording (or while armed)
+  halAccelIntBegin();
+#endif
 } 
 
 // -------------- INITIALIZE BUTTON -------------- // 
 void buttonInit() {
-  // setup button on PD4
-  // Configure DDRD4 Bit as input for the button
-  DDRD &= ~(1 << 4);
+  // setup button on PD4, presses arrive as EV_BUTTON from its edge interrupt
+  buttonBegin();
 }
 
 // -------------- INITIALIZE NEOPIXELS -------------- // 
@@ -224,151 +474,552 @@ void neoInit() {
 }
 
 // -------------- COLOR NEOPIXELS -------------- // 
-// takes in RGB values and changes to that color
-void setNeo(uint16_t r, uint16_t g, uint16_t b) {
-  strip.clear();
-  for(int i = 0; i < NUM_PIXELS; i++){
-    strip.setPixelColor(i, r, g, b);
+// starts the animation of a state and shows its first frame right away
+// (the sample timer or FIFO of a new recording starts after this)
+void setNeo(uint8_t state) {
+  animStart(stateEffect[state], stateColor[state]);
+  animProgress(0, TIMER_COUNT);
+  neoPending = true;
+  neoShow();
+}
+
+// scheduler task, renders the next animation frame into the strip;
+// unchanged pixels leave the strip clean and show() skips the transmit
+void animTask() {
+  uint8_t irq = halIrqSave();
+  uint16_t done = timerCounter;
+  halIrqRestore(irq);
+
+#if USE_FIFO
+  // timerCounter only moves once per watermark batch, the samples in
+  // between are already in the LIS3DH FIFO, so count them by time
+  uint32_t queued = (halMillis() - recordStartMs) * SAMPLE_RATE / 1000;
+  if (queued > TIMER_COUNT) queued = TIMER_COUNT;
+  if (queued > done) done = queued;
+#endif
+#if MOTION_TRIGGER
+  // nothing recorded yet while waiting for motion
+  if (motionArmed) done = 0;
+#endif
+
+  animProgress(done, TIMER_COUNT);
+  animStep();
+  neoPending = true;
+}
+
+// sends a pending frame. Interrupts are off for the whole transmit, so
+// while Timer1 paces the samples the frame waits for the end of a sample
+// interrupt, leaving a full sample period before the next compare. (The
+// FIFO keeps sampling on its own, there any time is fine.)
+void neoService() {
+  if (!neoPending) return;
+#if !USE_FIFO
+  bool sampling = controlState == ST_RECORD_KEY ||
+                  controlState == ST_RECORD_UNLOCK;
+#if MOTION_TRIGGER
+  sampling = sampling && !motionArmed;
+#endif
+  if (sampling && !neoSlot) return;
+#endif
+  neoShow();
+}
+
+void neoShow() {
+  for (uint16_t i = 0; i < NUM_PIXELS; i++) {
+    strip.setPixelColor(i, animPixel(i, NUM_PIXELS));
   }
+  neoPending = false;
+  neoSlot = false;
+
+  PROFILE_SCOPE(PROF_NEO_SHOW);
   strip.show();
 }
 
-// -------------- BUTTON PRESS -------------- // 
-void onButtonPress() {
-  if (PIND & (1<<PIND4)) {
-    if (controlState == 7) {
-      controlState = 0;
-    } else {
-      controlState++;     // move to next state
-    }
-    delay(400);
+// -------------- MOTION TRIGGER -------------- // 
+#if MOTION_TRIGGER
+// routes the LIS3DH activity event to INT1, the next interrupt posts
+// EV_MOTION. In FIFO mode the FIFO streams while armed, so a capture
+// starts with up to LIS3DH_FIFO_DEPTH samples from before the threshold
+// was crossed (the beginning of the gesture).
+void armMotion() {
+  halInterruptsOff();
+  accel.read(LIS3DH_REFERENCE);   // high pass filter restarts from here
+  accel.read(LIS3DH_INT1_SRC);    // drop a latched event
+  accel.write(LIS3DH_INT1_CFG, LIS3DH_XHIE | LIS3DH_YHIE | LIS3DH_ZHIE);
+  accel.write(LIS3DH_CTRL_REG3, LIS3DH_I1_IA1);
+#if USE_FIFO
+  accel.write(LIS3DH_FIFO_CTRL_REG, LIS3DH_FIFO_BYPASS);
+  accel.write(LIS3DH_FIFO_CTRL_REG, LIS3DH_FIFO_STREAM | FIFO_WATERMARK);
+#endif
+  motionUs = 0;
+  motionArmed = true;
+  halAccelIntEnable();
+  halInterruptsOn();
+
+  halPrintln("Waiting for motion");
+}
+
+// stops the activity events, INT1 goes back to the FIFO watermark
+void disarmMotion() {
+  motionArmed = false;
+  accel.write(LIS3DH_INT1_CFG, 0);
+  accel.read(LIS3DH_INT1_SRC);
+#if USE_FIFO
+  accel.write(LIS3DH_CTRL_REG3, LIS3DH_I1_WTM);
+#else
+  halAccelIntDisable();
+  accel.write(LIS3DH_CTRL_REG3, 0);
+#endif
+}
+
+// counts decimated samples in a row whose summed XYZ change (in mg)
+// stays under QUIET_MG, checkRecording() ends the capture on a still run
+void trackQuiet(int16_t x, int16_t y, int16_t z) {
+  static int16_t lastX, lastY, lastZ;
+  uint16_t change = abs(x - lastX) + abs(y - lastY) + abs(z - lastZ);
+  lastX = x;
+  lastY = y;
+  lastZ = z;
+
+  if (change >= QUIET_MG) {
+    quietCount = 0;
+  } else if (quietCount < 255) {
+    quietCount++;
   }
 }
+#endif
 
 // -------------- START TIMER -------------- // 
-// starts Timer 1 with overflow freq at 50Hz to begin recording
+// starts Timer 1 at ACCEL_ODR to begin recording
+// or, in FIFO mode, restarts the LIS3DH FIFO and arms the watermark interrupt
 void startRecording() {
-  // clear global interrupts
-  cli();
+  // every capture starts from an empty window
+  filter.clear();
+  timerCounter = 0;
+  recordStartMs = halMillis();
+  unlockRejected = false;
+  recording = true;
+  fingerprintBegin(captureAcc);
+  bool preTrigger = false;
+#if MOTION_TRIGGER
+  preTrigger = motionUs != 0;
+  firstSampleUs = 0;
+  quietCount = 0;
+#endif
+#if STREAM_MATCH
+  if (controlState == ST_RECORD_UNLOCK) {
+    beginUnlockMatch();
+  }
+#endif
+
+#if USE_FIFO
+  halInterruptsOff();
+#if MOTION_TRIGGER
+  disarmMotion();
+#endif
+
+  if (preTrigger) {
+    // the FIFO streamed while armed, what it holds from before the
+    // trigger starts the capture, drained now instead of at the watermark
+    recordBatch();
+  } else {
+    // going through bypass empties the FIFO so the capture starts fresh
+    accel.write(LIS3DH_FIFO_CTRL_REG, LIS3DH_FIFO_BYPASS);
+    accel.write(LIS3DH_FIFO_CTRL_REG, LIS3DH_FIFO_STREAM | FIFO_WATERMARK);
+  }
+  halAccelIntEnable();
 
-  // clear timer registers before we use them
-  TCCR1A = 0; // Normal Operations, no PWM
-  TCCR1B = 0;
-  
-  // set CTC mode, clear on OCR1A
-  TCCR1B |= (1 << WGM12);
+  halInterruptsOn();
+#else
+  (void)preTrigger;
+#if MOTION_TRIGGER
+  disarmMotion();
+#endif
+  halTimerStart(ACCEL_ODR);
+#endif
 
-  // 64 prescaler
-  TCCR1B |= (1 << CS11) | (1 << CS10);
+  halPrintln("Timer Started");
+}
 
-   // calculate the wanted PWM 
-   // (F_CPU / 64) * (1 / 25) = 5000
-  OCR1A = 5000;
-  
-  // Enable Timer1 compare match interrupt
-  TIMSK1 |= (1 << OCIE1A);
+// -------------- STOP RECORDING -------------- // 
+// called from the sampling interrupts after every sample or batch
+void checkRecording() {
+  bool done = timerCounter == TIMER_COUNT;
+#if MOTION_TRIGGER
+  // a motion triggered capture also ends once the board is held still
+  done = done || (quietCount >= QUIET_SAMPLES && timerCounter >= MOTION_MIN_SAMPLES);
+#endif
 
-  // enable global interrupts
-  sei();
+  if (unlockRejected) {
+    stopRecording(EV_VALIDATE_FAIL);
+  } else if (done) {
+    stopRecording(EV_CAPTURE_DONE);
+  }
+}
 
-  Serial.println("Timer Started");
+// stops sampling and tells the state machine why (ev)
+void stopRecording(uint8_t ev) {
+  halPrint("Timer ended: ");
+  halPrintln(timerCounter);
+#if MOTION_TRIGGER
+  if (motionUs) {
+    halPrint("Motion to first sample (us): ");
+    halPrintln((long)(firstSampleUs - motionUs));
+    motionUs = 0;
+  }
+#endif
+  captureLength = timerCounter;
+  timerCounter = 0;   // Reset the buf index
+  unlockRejected = false;
+  recording = false;
+  eventPost(ev);
+
+#if USE_FIFO
+  halAccelIntDisable();
+  accel.write(LIS3DH_FIFO_CTRL_REG, LIS3DH_FIFO_BYPASS);
+#else
+  halTimerStop();
+#endif
 }
 
 // -------------- ACCELEROMETER READING -------------- // 
 // reads the accelerometer XYZ values
 // updates the XYZ accelerometer buffers 
-// uses a moving window average filter with window of size 7
-void recordValues(int16_t *bufX, int16_t *bufY, int16_t *bufZ) {
+// uses a moving window average filter with window of size WINDOW_SIZE
+// returns true when a decimated sample was stored
+bool recordValues(packedSample *out) {
   int16_t x, y, z;
-  int32_t X_avg = 0;
-  int32_t Y_avg = 0;
-  int32_t Z_avg = 0;
-
-  // continuosly read from OUT_X_L buffer (0x28)
-  PORTB &= ~(1 << SPI_CS);
-  SPI.transfer(0x28 | 0b11000000);
-  x = (int16_t) SPI.transfer(0x00); //Low byte
-  x += (((int16_t) SPI.transfer(0x00)) << 8); //High byte
-  y = (int16_t) SPI.transfer(0x00); //Low byte
-  y += (((int16_t) SPI.transfer(0x00)) << 8); //High byte
-  z = (int16_t) SPI.transfer(0x00); //Low byte
-  z += (((int16_t) SPI.transfer(0x00)) << 8); //High byte
-  PORTB |= (1 << SPI_CS);
-
-  //Data in the form of a 10 bit 2's complement left justifed 
-  //If MSB is 0, then shift right by 4
-  //IF MSB is 1, then shift left by 6 and add -1024 
-  x = (x >> 4);
-  y = (y >> 4);
-  z = (z >> 4);
-
-  for (int i = WINDOW_SIZE-2; i > -1; i--) {
-    X_window[i+1] = X_window[i];
-    Y_window[i+1] = Y_window[i];
-    Z_window[i+1] = Z_window[i];
-    X_avg+= X_window[i+1];
-    Y_avg+= Y_window[i+1];
-    Z_avg+= Z_window[i+1];
+  readSample(&x, &y, &z);
+  return storeSample(x, y, z, out);
+}
+
+// reads one raw XYZ sample in a single auto increment transfer
+// (OUT_X_L..OUT_Z_H are little endian int16, like the AVR and the host)
+void readSample(int16_t *x, int16_t *y, int16_t *z) {
+  PROFILE_SCOPE(PROF_SPI_BURST);
+  int16_t xyz[3];
+  accel.readBurst(LIS3DH_OUT_X_L, (uint8_t *)xyz, LIS3DH_SAMPLE_BYTES);
+  *x = xyz[0];
+  *y = xyz[1];
+  *z = xyz[2];
+}
+
+// -------------- ACCELEROMETER FIFO READING -------------- // 
+// drains every sample queued in the LIS3DH FIFO in one SPI burst
+// with FIFO enabled the address pointer wraps from OUT_Z_H back to
+// OUT_X_L, so one auto increment read walks through the whole queue
+// (the spi burst profile includes the filtering done between samples)
+void recordBatch() {
+  PROFILE_SCOPE(PROF_SPI_BURST);
+  uint8_t src = accel.read(LIS3DH_FIFO_SRC_REG);
+  uint8_t count = src & LIS3DH_FIFO_FSS;
+  if (src & LIS3DH_FIFO_OVRN) {
+    count = LIS3DH_FIFO_DEPTH;
   }
 
-  X_window[0] = x;
-  Y_window[0] = y;
-  Z_window[0] = z;
-  X_avg = (X_avg + x)/WINDOW_SIZE;
-  Y_avg = (Y_avg + y)/WINDOW_SIZE;
-  Z_avg = (Z_avg + z)/WINDOW_SIZE;
+  accel.burstBegin(LIS3DH_OUT_X_L);
+  for (uint8_t n = 0; n < count && timerCounter < TIMER_COUNT && !unlockRejected; n++) {
+    int16_t xyz[3];
+    {
+      PROFILE_SCOPE(PROF_SPI_SAMPLE);
+      accel.burstRead((uint8_t *)xyz, LIS3DH_SAMPLE_BYTES);
+    }
 
-  bufX[timerCounter] = X_avg;
-  bufY[timerCounter] = Y_avg;
-  bufZ[timerCounter] = Z_avg;
+    packedSample s;
+    if (storeSample(xyz[0], xyz[1], xyz[2], &s)) keepSample(s);
+  }
+  accel.burstEnd();
 }
 
-bool validateSequence(){
-  Serial.println("Validating Sequence");
-  double tolerance = (0.5); // 50% tolerance
-  int failureCount = 0; 
-
-  // compare all values
-  for (int i = 10; i < TIMER_COUNT; i++) {
-    bool x_valid = abs(((double)X_key[i] - (double)X_unlock[i]) / (double)X_key[i]) < tolerance;
-    bool y_valid = abs(((double)Y_key[i] - (double)Y_unlock[i]) / (double)Y_key[i]) < tolerance;
-    bool z_valid = abs(((double)Z_key[i] - (double)Z_unlock[i]) / (double)Z_key[i]) < tolerance;
-
-    // print buffer comparison
-    char buffer[30];
-    sprintf(buffer, "X: %4d Y: %4d Z: %4d", x_valid, y_valid, z_valid);
-    Serial.println(buffer);
-
-    // failure of 2 or more axes results in an increment in failureCount
-    if ((x_valid + y_valid + z_valid) < 2) {
-      failureCount++;
+// -------------- SAMPLE FILTERING -------------- // 
+// converts a raw LIS3DH sample, decimates it from ACCEL_ODR to SAMPLE_RATE
+// and packs every DECIMATION-th (filtered) value into *out;
+// returns true when a value came out
+bool storeSample(int16_t x, int16_t y, int16_t z, packedSample *out) {
+  PROFILE_SCOPE(PROF_FILTER);
+
+  if (!filter.decimate(x, y, z)) return false;
+
+#if MOTION_TRIGGER
+  trackQuiet(x, y, z);
+#endif
+
+  *out = filter.smooth(x, y, z);
+  return true;
+}
+
+// -------------- KEEP SAMPLE -------------- // 
+// puts a filtered sample at timerCounter: into the key buffer, or the
+// unlock buffer, or for a streamed unlock into the queue for the matchers
+void keepSample(const packedSample &s) {
+#if MOTION_TRIGGER
+  if (timerCounter == 0) firstSampleUs = halMicros();
+#endif
+  fingerprintAdd(captureAcc, s);
+#if STREAM_MATCH
+  if (timerCounter == FP_EARLY_SAMPLES - 1) earlyAcc = captureAcc;
+#endif
+  if (controlState == ST_RECORD_KEY) {
+    keySamples[timerCounter] = s;
+  } else {
+#if STREAM_MATCH
+    queueUnlockSample(s);
+#else
+    unlockSamples[timerCounter] = s;
+#endif
+  }
+  timerCounter++;
+}
+
+// -------------- STREAMING MATCH -------------- // 
+#if STREAM_MATCH
+// before an unlock: every slot holding a valid key joins the match, and
+// its key mean (past the warm-up) is taken for the lag alignment
+void beginUnlockMatch() {
+  queueHead = 0;
+  queueTail = 0;
+  slotLive = 0;
+  for (uint8_t slot = 0; slot < KEYSTORE_SLOTS; slot++) {
+    for (uint8_t k = 0; k < MATCH_LAGS; k++) {
+      matchStreamBegin(slotMatch[slot][k]);
+    }
+    uint8_t length = keystoreLength(slot, SAMPLE_RATE);
+    slotLength[slot] = length;
+    if (!length || length > TIMER_COUNT) continue;
+    slotLive |= 1 << slot;
+
+    int32_t x = 0, y = 0, z = 0;
+    for (uint8_t i = MATCH_START; i < length; i++) {
+      packedSample k = keystoreSample(slot, i);
+      x += k.x;
+      y += k.y;
+      z += k.z;
     }
+    packedSample mean = {0, 0, 0};
+    if (length > MATCH_START) {
+      mean.x = x / (length - MATCH_START);
+      mean.y = y / (length - MATCH_START);
+      mean.z = z / (length - MATCH_START);
+    }
+    matchCorrBegin(slotCorr[slot], mean);
   }
+}
 
-  // failure if fails at 15 or more points
-  if (failureCount >= 15) { 
-    return false;
-  } else {
-    return true;
+// interrupt context: hands a streamed unlock sample to matchQueued(), the
+// EEPROM reads and correlations of every key and lag would keep
+// interrupts off for milliseconds (a FIFO batch is several samples). A
+// full queue means loop() fell MATCH_QUEUE samples behind; the unlock is
+// rejected rather than matched with a gap.
+void queueUnlockSample(const packedSample &s) {
+  if ((uint8_t)(queueHead - queueTail) == MATCH_QUEUE) {
+    unlockRejected = true;
+    return;
   }
+  matchQueue[queueHead % MATCH_QUEUE] = s;
+  queueHead++;
 }
 
-// -------------- PRINT ACCELEROMETER RECORD (first set) -------------- // 
-void printBuffers() {
-  for (int i = 0; i < TIMER_COUNT; i++) {
-    char buffer[30];
-    sprintf(buffer, "X: %4d Y: %4d Z: %4d", X_key[i], Y_key[i], Z_key[i]);
-    Serial.println(buffer);
+// runs the queued unlock samples through the matchers, from loop() and
+// before validation. A rejected unlock stops the capture here instead of
+// waiting for the next sampling interrupt.
+void matchQueued() {
+  for (;;) {
+    uint8_t irq = halIrqSave();
+    bool empty = queueTail == queueHead;
+    packedSample s = matchQueue[queueTail % MATCH_QUEUE];
+    halIrqRestore(irq);
+    if (empty) break;
+
+    // earlyAcc was taken before this sample was queued
+    if (queueTail == FP_EARLY_SAMPLES - 1) screenEarly();
+    matchUnlockSample(queueTail, s);
+    queueTail++;
   }
+
+  if (!unlockRejected) return;
+  uint8_t irq = halIrqSave();
+  if (recording) stopRecording(EV_VALIDATE_FAIL);
+  halIrqRestore(irq);
 }
 
-// -------------- PRINT ACCELEROMETER RECORD (both sets) -------------- // 
-void printBuffersAll() {
-  for (int i = 0; i < TIMER_COUNT; i++) {
-    char buffer[60];
-    sprintf(buffer, "First: X: %4d Y: %4d Z: %4d Second: X: %4d Y: %4d Z: %4d", 
-                X_key[i], Y_key[i], Z_key[i],
-                X_unlock[i], Y_unlock[i], Z_unlock[i]);
-    Serial.println(buffer);
+// compares unlock sample j against key sample j - lag
+// of every key still in the running (read from the EEPROM), for every
+// lag at once, and adds the pair to that lag's correlation. The same
+// pairs matchAlign() and matchFixed() see on a buffered unlock. A key
+// drops out once no lag can pass, the unlock is rejected as soon as no
+// key is left.
+void matchUnlockSample(uint16_t j, const packedSample &s) {
+  PROFILE_SCOPE(PROF_MATCHER);
+  for (uint8_t slot = 0; slot < KEYSTORE_SLOTS; slot++) {
+    if (!(slotLive & (1 << slot))) continue;
+    uint8_t length = slotLength[slot];
+
+    // past the end of this key, the unlock may only run a little longer
+    if (j >= length + MATCH_LAG_MAX + MATCH_LENGTH_SLACK) {
+      slotLive &= ~(1 << slot);
+      continue;
+    }
+
+    bool alive = false;
+    for (int8_t lag = -MATCH_LAG_MAX; lag <= MATCH_LAG_MAX; lag++) {
+      matchStream &m = slotMatch[slot][lag + MATCH_LAG_MAX];
+      int16_t i = (int16_t)j - lag;
+      if (i < 0 || i >= length) {
+        alive = alive || matchStreamAlive(m);
+        continue;
+      }
+      packedSample k = keystoreSample(slot, i);
+      if (i >= MATCH_START && j >= MATCH_START) {
+        matchCorrPush(slotCorr[slot], lag, k, s);
+      }
+      if (matchStreamPush(m, k, s)) alive = true;
+    }
+    if (!alive) slotLive &= ~(1 << slot);
   }
+  if (!slotLive) unlockRejected = true;
+}
+
+// the pre-screen of a streamed unlock, before it is fully recorded: keys
+// whose first FP_EARLY_SAMPLES are further than FP_EARLY_REJECT_DISTANCE
+// from the unlock's drop out of the match (shorter keys stay in). Their
+// fingerprints are read from the EEPROM here, once per unlock, instead
+// of held in RAM.
+void screenEarly() {
+  PROFILE_SCOPE(PROF_SCREEN);
+  fingerprint print, key;
+  fingerprintEnd(earlyAcc, &print);
+  for (uint8_t slot = 0; slot < KEYSTORE_SLOTS; slot++) {
+    if (!(slotLive & (1 << slot)) || slotLength[slot] < FP_EARLY_SAMPLES) continue;
+    fingerprintAcc acc;
+    fingerprintBegin(acc);
+    for (uint8_t i = 0; i < FP_EARLY_SAMPLES; i++) {
+      fingerprintAdd(acc, keystoreSample(slot, i));
+    }
+    fingerprintEnd(acc, &key);
+    if (fingerprintDistance(key, print) > FP_EARLY_REJECT_DISTANCE) {
+      slotLive &= ~(1 << slot);
+    }
+  }
+}
+#endif
+
+// -------------- KEY PRE-SCREEN -------------- // 
+// fingerprints of the stored keys, read once at boot (a new key takes the
+// fingerprint of its capture)
+void refreshKeyPrints() {
+  for (uint8_t slot = 0; slot < KEYSTORE_SLOTS; slot++) {
+    uint8_t length = keystoreLength(slot, SAMPLE_RATE);
+    fingerprintAcc acc;
+    fingerprintBegin(acc);
+    for (uint8_t i = 0; i < length; i++) {
+      fingerprintAdd(acc, keystoreSample(slot, i));
+    }
+    fingerprintEnd(acc, &keyPrint[slot]);
+  }
+}
+
+// compares the unlock fingerprint against every key's, fills order with
+// the slots within reject, closest first, returns how many (empty slots
+// are left to the caller, they fail its validity check)
+uint8_t screenKeys(uint8_t *order, uint16_t reject) {
+  PROFILE_SCOPE(PROF_SCREEN);
+  fingerprint print;
+  fingerprintEnd(captureAcc, &print);
+
+  uint16_t distance[KEYSTORE_SLOTS];
+  uint8_t count = 0;
+  for (uint8_t slot = 0; slot < KEYSTORE_SLOTS; slot++) {
+    uint16_t d = fingerprintDistance(keyPrint[slot], print);
+    if (d > reject) continue;
+
+    // insertion into the sorted order
+    uint8_t n = count++;
+    while (n && distance[n - 1] > d) {
+      distance[n] = distance[n - 1];
+      order[n] = order[n - 1];
+      n--;
+    }
+    distance[n] = d;
+    order[n] = slot;
+  }
+  return count;
+}
+
+// -------------- VALIDATE UNLOCK -------------- // 
+// Streamed: the unlock was matched (and pre-screened by screenEarly())
+// while it was recorded, the fingerprints only rank the keys still in
+// the running; one passes when it passed at its best correlated lag.
+// Otherwise the fingerprint pre-screen drops keys that are clearly
+// different, then the unlock recording is compared against the rest,
+// closest first, with the selected matcher; each slot is decoded into
+// the key buffer in turn.
+bool validateSequence(){
+  halPrintln("Validating Sequence");
+  uint8_t order[KEYSTORE_SLOTS];
+
+#if STREAM_MATCH
+  // the last samples may have come in with the end of the capture
+  matchQueued();
+  uint8_t candidates = screenKeys(order, 0xFFFF);
+  for (uint8_t c = 0; c < candidates; c++) {
+    uint8_t slot = order[c];
+    if (!(slotLive & (1 << slot))) continue;
+
+    // lengths of the shifted key and unlock, as matchShift() cuts them
+    int8_t lag = matchCorrBest(slotCorr[slot]);
+    int16_t keyLength = slotLength[slot];
+    int16_t unlockLength = captureLength;
+    if (lag > 0) unlockLength -= lag;
+    if (lag < 0) keyLength += lag;
+
+    if (matchStreamAlive(slotMatch[slot][lag + MATCH_LAG_MAX]) &&
+        unlockLength > 0 && keyLength > 0 &&
+        matchLengths(keyLength, unlockLength)) {
+      halPrint("Matched slot ");
+      halPrintln((long)slot);
+      return true;
+    }
+  }
+  return false;
+#else
+  uint8_t candidates = screenKeys(order, FP_REJECT_DISTANCE);
+  const gesture unlock = {unlockSamples, captureLength};
+
+  for (uint8_t c = 0; c < candidates; c++) {
+    uint8_t slot = order[c];
+    uint8_t length = keystoreLength(slot, SAMPLE_RATE);
+    if (!length || length > TIMER_COUNT ||
+        !keystoreLoad(slot, SAMPLE_RATE, length, keySamples)) {
+      continue;
+    }
+    sendBuffers(length);
+    const gesture key = {keySamples, length};
+
+    PROFILE_SCOPE(PROF_MATCHER);
+    if (matchGesture(key, unlock)) {
+      halPrint("Matched slot ");
+      halPrintln((long)slot);
+      return true;
+    }
+  }
+  return false;
+#endif
+}
+
+// -------------- SEND ACCELEROMETER RECORD (key) -------------- // 
+// binary telemetry, decode on the host with the telemetry_decode env.
+// The key buffer holds a new key, or the slot validateSequence() just
+// loaded, which is sent before the matcher runs on it
+void sendBuffers(uint8_t length) {
+  PROFILE_SCOPE(PROF_DUMP);
+  telemetrySendCapture(TELEM_KEY, keySamples, length);
+}
+
+// -------------- SEND ACCELEROMETER RECORD (unlock) -------------- // 
+// (a streamed unlock is not kept, there is nothing to send)
+#if !STREAM_MATCH
+void sendUnlock() {
+  PROFILE_SCOPE(PROF_DUMP);
+  telemetrySendCapture(TELEM_UNLOCK, unlockSamples, captureLength);
 }
+#endif
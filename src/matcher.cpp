@@ -0,0 +1,225 @@
+#include "matcher.h"
+#include <math.h>
+
+// -------------- FLOATING POINT MATCHER -------------- //
+// reference version, compares |key - unlock| / key against the tolerance
+// a zero key value divides by zero and counts as invalid (inf or NaN)
+bool matchFloat(const gesture &key, const gesture &unlock) {
+  double tolerance = (0.5); // 50% tolerance
+  int failureCount = 0;
+
+  if (!matchLengths(key.length, unlock.length)) return false;
+  int length = key.length < unlock.length ? key.length : unlock.length;
+
+  // compare all values
+  for (int i = MATCH_START; i < length; i++) {
+    bool x_valid = fabs(((double)key.x(i) - (double)unlock.x(i)) / (double)key.x(i)) < tolerance;
+    bool y_valid = fabs(((double)key.y(i) - (double)unlock.y(i)) / (double)key.y(i)) < tolerance;
+    bool z_valid = fabs(((double)key.z(i) - (double)unlock.z(i)) / (double)key.z(i)) < tolerance;
+
+    // failure of 2 or more axes results in an increment in failureCount
+    if ((x_valid + y_valid + z_valid) < 2) {
+      failureCount++;
+    }
+  }
+
+  // failure if fails at 15 or more points
+  return failureCount < MATCH_MAX_FAILURES;
+}
+
+// -------------- FIXED POINT MATCHER -------------- //
+// |k - u| / |k| < tol  <=>  |k - u| << MATCH_Q < tol_q8 * |k|
+// no division, and a zero key is invalid the same way as the float version
+static inline bool axisValid(int16_t k, int16_t u) {
+  int32_t diff = (int32_t)k - u;
+  int32_t mag = k;
+  if (diff < 0) diff = -diff;
+  if (mag < 0) mag = -mag;
+  return (diff << MATCH_Q) < (int32_t)MATCH_TOLERANCE_Q8 * mag;
+}
+
+// a sample fails when fewer than two of its axes are within tolerance
+static inline bool sampleValid(const packedSample &key, const packedSample &unlock) {
+  uint8_t valid = axisValid(key.x, unlock.x)
+                + axisValid(key.y, unlock.y)
+                + axisValid(key.z, unlock.z);
+  return valid >= 2;
+}
+
+bool matchStreamPush(matchStream &m, const packedSample &key,
+                     const packedSample &unlock) {
+  if (m.failures >= MATCH_MAX_FAILURES) return false;
+  if (m.index++ < MATCH_START) return true;
+
+  // reject as soon as the unlock can no longer pass
+  if (!sampleValid(key, unlock) && ++m.failures >= MATCH_MAX_FAILURES) {
+    return false;
+  }
+  return true;
+}
+
+// the same decisions as matchStreamPush() over the whole capture, with the
+// sample test inlined and the failures counted without a branch
+bool matchFixed(const gesture &key, const gesture &unlock) {
+  if (!matchLengths(key.length, unlock.length)) return false;
+  uint16_t length = key.length < unlock.length ? key.length : unlock.length;
+
+  uint8_t failures = 0;
+  for (uint16_t i = MATCH_START; i < length; i++) {
+    failures += !sampleValid(key.samples[i], unlock.samples[i]);
+    if (failures >= MATCH_MAX_FAILURES) return false;
+  }
+
+  return true;
+}
+
+// -------------- LAG ALIGNMENT -------------- //
+#if MATCH_LAG_MAX > MATCH_LENGTH_SLACK
+#error "an aligned unlock has to pass the length check"
+#endif
+
+void matchCorrBegin(matchCorr &c, const packedSample &keyMean) {
+  c.mean = keyMean;
+  for (uint8_t k = 0; k < MATCH_LAGS; k++) {
+    c.sum[k] = 0;
+    c.count[k] = 0;
+  }
+}
+
+// sum[a] / count[a] > sum[b] / count[b], cross multiplied in 64 bits: a
+// sum is up to count * 3 * 255 * 128, so sum * count leaves 32 bits past
+// about 148 pairs (runs 2 * MATCH_LAG_MAX times per decision)
+static bool corrAbove(const matchCorr &c, uint8_t a, uint8_t b) {
+  return (int64_t)c.sum[a] * c.count[b] > (int64_t)c.sum[b] * c.count[a];
+}
+
+// lag 0 first, then -1, +1, -2, +2 ... so a tie keeps the smaller shift
+int8_t matchCorrBest(const matchCorr &c) {
+  uint8_t best = MATCH_LAG_MAX;
+  for (uint8_t d = 1; d <= MATCH_LAG_MAX; d++) {
+    uint8_t k = MATCH_LAG_MAX - d;
+    if (c.count[k] && (!c.count[best] || corrAbove(c, k, best))) best = k;
+    k = MATCH_LAG_MAX + d;
+    if (c.count[k] && (!c.count[best] || corrAbove(c, k, best))) best = k;
+  }
+  return (int8_t)best - MATCH_LAG_MAX;
+}
+
+packedSample matchMean(const gesture &key) {
+  int32_t x = 0, y = 0, z = 0;
+  for (uint16_t i = MATCH_START; i < key.length; i++) {
+    x += key.x(i);
+    y += key.y(i);
+    z += key.z(i);
+  }
+  packedSample mean = {0, 0, 0};
+  if (key.length > MATCH_START) {
+    int32_t n = key.length - MATCH_START;
+    mean.x = x / n;
+    mean.y = y / n;
+    mean.z = z / n;
+  }
+  return mean;
+}
+
+int8_t matchAlign(const gesture &key, const gesture &unlock) {
+  matchCorr c;
+  matchCorrBegin(c, matchMean(key));
+
+  for (int8_t lag = -MATCH_LAG_MAX; lag <= MATCH_LAG_MAX; lag++) {
+    for (int16_t i = MATCH_START; i < (int16_t)key.length; i++) {
+      int16_t j = i + lag;
+      if (j < MATCH_START || j >= (int16_t)unlock.length) continue;
+      matchCorrPush(c, lag, key.samples[i], unlock.samples[j]);
+    }
+  }
+  return matchCorrBest(c);
+}
+
+void matchShift(const gesture &key, const gesture &unlock, int8_t lag,
+                gesture *keyOut, gesture *unlockOut) {
+  *keyOut = key;
+  *unlockOut = unlock;
+  if (lag > 0) {
+    uint16_t n = unlock.length < (uint16_t)lag ? unlock.length : lag;
+    unlockOut->samples += n;
+    unlockOut->length -= n;
+  } else if (lag < 0) {
+    uint16_t n = key.length < (uint16_t)-lag ? key.length : -lag;
+    keyOut->samples += n;
+    keyOut->length -= n;
+  }
+}
+
+// -------------- DYNAMIC TIME WARPING MATCHER -------------- //
+#define DTW_INF 0xFFFFFFFFUL
+
+static inline uint16_t absDiff(int16_t a, int16_t b) {
+  return (a > b) ? (uint16_t)(a - b) : (uint16_t)(b - a);
+}
+
+// L1 distance between key sample i and unlock sample j
+static inline uint16_t sampleCost(const gesture &key, uint16_t i,
+                                  const gesture &unlock, uint16_t j) {
+  return absDiff(key.x(i), unlock.x(j))
+       + absDiff(key.y(i), unlock.y(j))
+       + absDiff(key.z(i), unlock.z(j));
+}
+
+// row slot k holds column j = i + k - MATCH_DTW_BAND
+// (i-1, j) is prev[k+1], (i-1, j-1) is prev[k] and (i, j-1) is cur[k-1]
+bool matchDtw(const gesture &key, const gesture &unlock) {
+  uint32_t rows[2][MATCH_DTW_WIDTH];
+  uint32_t *prev = rows[0];
+  uint32_t *cur = rows[1];
+  uint16_t n = key.length;
+  uint16_t m = unlock.length;
+
+  // the end cell has to lie inside the band
+  if (n <= MATCH_START || m <= MATCH_START) return false;
+  int16_t endSlot = (int16_t)(m - n) + MATCH_DTW_BAND;
+  if (endSlot < 0 || endSlot >= MATCH_DTW_WIDTH) return false;
+
+  // path cost budget from the key magnitude
+  uint32_t keyMag = 0;
+  for (uint16_t i = MATCH_START; i < n; i++) {
+    keyMag += absDiff(key.x(i), 0) + absDiff(key.y(i), 0) + absDiff(key.z(i), 0);
+  }
+  uint32_t budget = ((uint32_t)MATCH_DTW_TOLERANCE_Q8 * keyMag) >> MATCH_Q;
+
+  for (uint16_t i = MATCH_START; i < n; i++) {
+    uint32_t rowMin = DTW_INF;
+
+    for (uint8_t k = 0; k < MATCH_DTW_WIDTH; k++) {
+      int16_t j = (int16_t)i + k - MATCH_DTW_BAND;
+      if (j < MATCH_START || j >= (int16_t)m) {
+        cur[k] = DTW_INF;
+        continue;
+      }
+
+      uint32_t best;
+      if (i == MATCH_START && j == MATCH_START) {
+        best = 0;
+      } else {
+        best = DTW_INF;
+        if (i > MATCH_START) {
+          if (k + 1 < MATCH_DTW_WIDTH && prev[k + 1] < best) best = prev[k + 1];
+          if (prev[k] < best) best = prev[k];
+        }
+        if (k > 0 && cur[k - 1] < best) best = cur[k - 1];
+      }
+
+      cur[k] = (best == DTW_INF) ? DTW_INF : best + sampleCost(key, i, unlock, j);
+      if (cur[k] < rowMin) rowMin = cur[k];
+    }
+
+    // costs only grow along the path, give up once every cell is over budget
+    if (rowMin >= budget) return false;
+
+    uint32_t *tmp = prev;
+    prev = cur;
+    cur = tmp;
+  }
+
+  return prev[endSlot] < budget;
+}
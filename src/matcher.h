@@ -0,0 +1,147 @@
+#ifndef MATCHER_H
+#define MATCHER_H
+
+#include <stdint.h>
+#include <capture.h>
+
+// matcher selection (set MATCHER before including, default fixed point)
+#define MATCHER_FLOAT 0    // original double precision ratio test
+#define MATCHER_FIXED 1    // integer cross multiplication
+#define MATCHER_DTW 2      // banded dynamic time warping
+
+#ifndef MATCHER
+#define MATCHER MATCHER_FIXED
+#endif
+
+#define MATCH_START 10         // skip the moving average warm-up samples
+#define MATCH_MAX_FAILURES 15  // failures at this count reject the unlock
+
+// motion triggered captures end on inactivity, so key and unlock lengths
+// vary; they may differ by this many samples (240ms at 25Hz), and the
+// sample by sample tests compare the shorter length
+#define MATCH_LENGTH_SLACK 6
+
+// per axis tolerance as a Q8 fraction of the key value
+// a sample is valid when |key - unlock| < tolerance * |key|
+#define MATCH_Q 8
+#define MATCH_TOLERANCE_Q8 128 // 0.5 -> 50% tolerance
+
+// dynamic time warping
+// the warping path may drift at most MATCH_DTW_BAND samples from the
+// diagonal (Sakoe-Chiba band, 6 samples = 240ms at 25Hz), and the unlock
+// passes when the summed L1 path cost stays under the tolerance times the
+// summed L1 magnitude of the key
+#define MATCH_DTW_BAND 6
+#define MATCH_DTW_WIDTH (2 * MATCH_DTW_BAND + 1)
+#define MATCH_DTW_TOLERANCE_Q8 128 // 0.5 -> 50% tolerance
+
+// three axis recording of length packed samples
+// the accessors return quantized units (2^SAMPLE_SHIFT raw counts per
+// LSB). Every test below is a ratio against the key (or a cost against
+// a budget taken from the key), so the scale drops out and the matchers
+// read the packed bytes directly.
+struct gesture {
+    const packedSample *samples;
+    uint16_t length;
+
+    int16_t x(uint16_t i) const { return samples[i].x; }
+    int16_t y(uint16_t i) const { return samples[i].y; }
+    int16_t z(uint16_t i) const { return samples[i].z; }
+};
+
+inline bool matchLengths(uint16_t keyLength, uint16_t unlockLength) {
+    uint16_t diff = keyLength > unlockLength ? keyLength - unlockLength
+                                             : unlockLength - keyLength;
+    return diff <= MATCH_LENGTH_SLACK;
+}
+
+// returns true if unlock matches key
+// a sample fails when fewer than two of its axes are within tolerance,
+// and MATCH_MAX_FAILURES failed samples reject the unlock
+bool matchFloat(const gesture &key, const gesture &unlock);
+bool matchFixed(const gesture &key, const gesture &unlock);
+
+// the fixed point test fed one sample pair at a time, so an unlock can be
+// matched while it is recorded (the same decisions as matchFixed())
+struct matchStream {
+    uint16_t index;      // sample pairs seen
+    uint8_t failures;    // failed samples so far
+};
+
+inline void matchStreamBegin(matchStream &m) {
+    m.index = 0;
+    m.failures = 0;
+}
+
+// feeds the next key and unlock sample, returns false once the unlock
+// can no longer pass (and for every sample after that)
+bool matchStreamPush(matchStream &m, const packedSample &key,
+                     const packedSample &unlock);
+
+inline bool matchStreamAlive(const matchStream &m) {
+    return m.failures < MATCH_MAX_FAILURES;
+}
+
+// lag alignment
+// reaction time moves the unlock a few samples against the key. Before
+// the sample by sample tests run, the unlock is shifted to the lag in
+// [-MATCH_LAG_MAX, MATCH_LAG_MAX] with the highest cross-correlation
+//   sum over the overlap (both sides past MATCH_START) and the three axes
+//   of (key - key mean) * unlock, divided by the overlap length
+// A positive lag means the unlock started late: unlock sample i + lag
+// lines up with key sample i. MATCH_LAG_MAX 0 turns the search off.
+#define MATCH_LAG_MAX 4        // 160ms at 25Hz, at most MATCH_LENGTH_SLACK
+#define MATCH_LAGS (2 * MATCH_LAG_MAX + 1)
+
+// correlation of every lag, fed one key/unlock pair at a time
+struct matchCorr {
+    packedSample mean;             // key mean past MATCH_START
+    int32_t sum[MATCH_LAGS];       // index lag + MATCH_LAG_MAX
+    uint8_t count[MATCH_LAGS];     // pairs in the overlap
+};
+
+void matchCorrBegin(matchCorr &c, const packedSample &keyMean);
+
+inline void matchCorrPush(matchCorr &c, int8_t lag, const packedSample &key,
+                          const packedSample &unlock) {
+    uint8_t k = lag + MATCH_LAG_MAX;
+    c.sum[k] += (int32_t)(key.x - c.mean.x) * unlock.x
+              + (int32_t)(key.y - c.mean.y) * unlock.y
+              + (int32_t)(key.z - c.mean.z) * unlock.z;
+    c.count[k]++;
+}
+
+// the lag with the highest correlation, the smallest one on a tie
+int8_t matchCorrBest(const matchCorr &c);
+
+// key mean past MATCH_START
+packedSample matchMean(const gesture &key);
+
+// best lag of unlock against key
+int8_t matchAlign(const gesture &key, const gesture &unlock);
+
+// key and unlock views that line up at lag (no copy)
+void matchShift(const gesture &key, const gesture &unlock, int8_t lag,
+                gesture *keyOut, gesture *unlockOut);
+
+// same decision shape as above but lets the unlock run a little faster or
+// slower than the key; keeps two band-wide rows of the cost matrix
+bool matchDtw(const gesture &key, const gesture &unlock);
+
+// the matcher picked by MATCHER, the sample by sample ones after lag
+// alignment (DTW does its own)
+inline bool matchGesture(const gesture &key, const gesture &unlock) {
+#if MATCHER == MATCHER_DTW
+    return matchDtw(key, unlock);
+#else
+    gesture k, u;
+    matchShift(key, unlock, matchAlign(key, unlock), &k, &u);
+#if MATCHER == MATCHER_FLOAT
+    return matchFloat(k, u);
+#else
+    return matchFixed(k, u);
+#endif
+#endif
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef MOVINGAVG_H
+#define MOVINGAVG_H
+
+#include <stdint.h>
+#include <string.h>
+
+// moving window average filter of N samples
+// keeps a ring buffer with a head index and a running sum so every
+// update costs the same no matter how large the window is.
+// output matches the old shift-and-sum filter: the window starts out
+// filled with zeros and the sum is divided by the full window size.
+template <uint8_t N>
+class movingavg {
+public:
+    movingavg(void) { clear(); }
+
+    // push a new sample and return the current window average
+    int16_t update(int16_t sample) {
+        sum += sample - window[head];
+        window[head] = sample;
+        if (++head == N) head = 0;
+        return sum / N;
+    }
+
+    // empty the window (all zeros) in one call
+    void clear(void) {
+        memset((void *)window, 0, sizeof(window));
+        sum = 0;
+        head = 0;
+    }
+
+protected:
+    int16_t window[N];  // last N samples, oldest at head
+    int32_t sum;        // running sum of window
+    uint8_t head;       // index of the oldest sample
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef NEOTRANSMIT_H
+#define NEOTRANSMIT_H
+
+// WS2812 transmit kernel shared by colorlib and StaticStrip
+
+#include <hal.h>
+
+// NeoPixel output ports as I/O addresses (the same on the 32u4 and 328P),
+// DDRx sits one address below PORTx
+#define NEO_PORTB 0x05
+#define NEO_PORTC 0x08
+#define NEO_PORTD 0x0B
+#define NEO_PORTF 0x11
+
+#ifdef __AVR__
+
+#if !((F_CPU >= 7400000UL) && (F_CPU <= 9500000UL))
+ #error "CPU SPEED NOT SUPPORTED"
+#endif
+
+/*!
+  @brief   Clock numBytes of pixel data out on one PORT bit at 800 KHz
+           (8 MHz AVR). The port is a template parameter, so the OUT
+           instructions target it directly and each build carries only
+           the ports it uses. Interrupts must already be disabled.
+  @tparam  Port      Output port I/O address, NEO_PORTB/C/D/F.
+  @param   pinMask   Output PORT bitmask, folded when it is a constant.
+  @param   pixels    Pixel bytes in transmit order.
+  @param   numBytes  Number of bytes to send, at least 1.
+*/
+template <uint8_t Port>
+inline __attribute__((always_inline))
+void neoTransmit(uint8_t pinMask, const uint8_t *pixels, uint16_t numBytes) {
+  volatile uint16_t
+    i   = numBytes; // Loop counter
+  volatile const uint8_t
+   *ptr = pixels;   // Pointer to next byte
+  volatile uint8_t
+    b   = *ptr++,   // Current byte value
+    hi,             // PORT w/output bit set high
+    lo;             // PORT w/output bit set low
+  volatile uint8_t n1, n2 = 0;  // First, next bits out
+
+  hi = _SFR_IO8(Port) |  pinMask;
+  lo = _SFR_IO8(Port) & ~pinMask;
+  n1 = lo;
+  if(b & 0x80) n1 = hi;
+
+  asm volatile(
+   "1:"                       "\n\t" // Clk  Pseudocode
+    // Bit 7:
+    "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
+    "mov  %[n2]   , %[lo]"    "\n\t" // 1    n2   = lo
+    "out  %[port] , %[n1]"    "\n\t" // 1    PORT = n1
+    "rjmp .+0"                "\n\t" // 2    nop nop
+    "sbrc %[byte] , 6"        "\n\t" // 1-2  if(b & 0x40)
+     "mov %[n2]   , %[hi]"    "\n\t" // 0-1   n2 = hi
+    "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
+    "rjmp .+0"                "\n\t" // 2    nop nop
+    // Bit 6:
+    "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
+    "mov  %[n1]   , %[lo]"    "\n\t" // 1    n1   = lo
+    "out  %[port] , %[n2]"    "\n\t" // 1    PORT = n2
+    "rjmp .+0"                "\n\t" // 2    nop nop
+    "sbrc %[byte] , 5"        "\n\t" // 1-2  if(b & 0x20)
+     "mov %[n1]   , %[hi]"    "\n\t" // 0-1   n1 = hi
+    "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
+    "rjmp .+0"                "\n\t" // 2    nop nop
+    // Bit 5:
+    "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
+    "mov  %[n2]   , %[lo]"    "\n\t" // 1    n2   = lo
+    "out  %[port] , %[n1]"    "\n\t" // 1    PORT = n1
+    "rjmp .+0"                "\n\t" // 2    nop nop
+    "sbrc %[byte] , 4"        "\n\t" // 1-2  if(b & 0x10)
+     "mov %[n2]   , %[hi]"    "\n\t" // 0-1   n2 = hi
+    "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
+    "rjmp .+0"                "\n\t" // 2    nop nop
+    // Bit 4:
+    "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
+    "mov  %[n1]   , %[lo]"    "\n\t" // 1    n1   = lo
+    "out  %[port] , %[n2]"    "\n\t" // 1    PORT = n2
+    "rjmp .+0"                "\n\t" // 2    nop nop
+    "sbrc %[byte] , 3"        "\n\t" // 1-2  if(b & 0x08)
+     "mov %[n1]   , %[hi]"    "\n\t" // 0-1   n1 = hi
+    "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
+    "rjmp .+0"                "\n\t" // 2    nop nop
+    // Bit 3:
+    "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
+    "mov  %[n2]   , %[lo]"    "\n\t" // 1    n2   = lo
+    "out  %[port] , %[n1]"    "\n\t" // 1    PORT = n1
+    "rjmp .+0"                "\n\t" // 2    nop nop
+    "sbrc %[byte] , 2"        "\n\t" // 1-2  if(b & 0x04)
+     "mov %[n2]   , %[hi]"    "\n\t" // 0-1   n2 = hi
+    "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
+    "rjmp .+0"                "\n\t" // 2    nop nop
+    // Bit 2:
+    "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
+    "mov  %[n1]   , %[lo]"    "\n\t" // 1    n1   = lo
+    "out  %[port] , %[n2]"    "\n\t" // 1    PORT = n2
+    "rjmp .+0"                "\n\t" // 2    nop nop
+    "sbrc %[byte] , 1"        "\n\t" // 1-2  if(b & 0x02)
+     "mov %[n1]   , %[hi]"    "\n\t" // 0-1   n1 = hi
+    "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
+    "rjmp .+0"                "\n\t" // 2    nop nop
+    // Bit 1:
+    "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
+    "mov  %[n2]   , %[lo]"    "\n\t" // 1    n2   = lo
+    "out  %[port] , %[n1]"    "\n\t" // 1    PORT = n1
+    "rjmp .+0"                "\n\t" // 2    nop nop
+    "sbrc %[byte] , 0"        "\n\t" // 1-2  if(b & 0x01)
+     "mov %[n2]   , %[hi]"    "\n\t" // 0-1   n2 = hi
+    "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
+    "sbiw %[count], 1"        "\n\t" // 2    i-- (don't act on Z flag yet)
+    // Bit 0:
+    "out  %[port] , %[hi]"    "\n\t" // 1    PORT = hi
+    "mov  %[n1]   , %[lo]"    "\n\t" // 1    n1   = lo
+    "out  %[port] , %[n2]"    "\n\t" // 1    PORT = n2
+    "ld   %[byte] , %a[ptr]+" "\n\t" // 2    b = *ptr++
+    "sbrc %[byte] , 7"        "\n\t" // 1-2  if(b & 0x80)
+     "mov %[n1]   , %[hi]"    "\n\t" // 0-1   n1 = hi
+    "out  %[port] , %[lo]"    "\n\t" // 1    PORT = lo
+    "brne 1b"                 "\n"   // 2    while(i) (Z flag set above)
+  : [byte]  "+r" (b),
+    [n1]    "+r" (n1),
+    [n2]    "+r" (n2),
+    [count] "+w" (i)
+  : [port]   "I" (Port),
+    [ptr]    "e" (ptr),
+    [hi]     "r" (hi),
+    [lo]     "r" (lo));
+}
+
+#endif
+
+#endif
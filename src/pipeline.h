@@ -0,0 +1,28 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+// capture and matching settings
+// everything between a raw LIS3DH sample and the pass/fail decision, in
+// one place so the firmware (main.cpp) and the host tools (src/tools)
+// run the same pipeline with the same numbers.
+
+#include <lis3dh.h>    // accelerometer register map
+#include <capturefilter.h> // decimation, moving average, packing
+#define MATCHER MATCHER_FIXED  // or MATCHER_FLOAT / MATCHER_DTW
+#include <matcher.h>   // key/unlock comparison
+#include <fingerprint.h> // capture summary for the key pre-screen
+
+#define ACCEL_ODR 100      // LIS3DH output data rate: 25, 50, 100, 200 or 400Hz
+#define SAMPLE_RATE 25     // matching rate in Hz, ACCEL_ODR is decimated to it
+#define DECIMATION (ACCEL_ODR / SAMPLE_RATE)
+#define CIC_ORDER 3        // decimation filter stages
+#define TIMER_COUNT 25*3   // 75 counts for 25Hz in 3sec
+#define WINDOW_SIZE 31     // moving average filter window size
+
+#if LIS3DH_ODR(ACCEL_ODR) == 0 || ACCEL_ODR % SAMPLE_RATE != 0
+#error "ACCEL_ODR must be a LIS3DH rate and a multiple of SAMPLE_RATE"
+#endif
+
+typedef captureFilter<DECIMATION, CIC_ORDER, WINDOW_SIZE> sentryFilter;
+
+#endif
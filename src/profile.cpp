@@ -0,0 +1,65 @@
+#include "profile.h"
+
+#if PROFILE_ENABLED
+
+#include "hal.h"
+#include <stdio.h>
+
+static profileStat table[PROF_SECTIONS];
+
+static const char *const sectionNames[PROF_SECTIONS] = {
+  "sample isr",
+  "spi burst",
+  "spi sample",
+  "filter",
+  "matcher",
+  "screen",
+  "neo show",
+  "dump",
+};
+
+// starts the cycle counter and clears the table
+void profileInit() {
+  halCycleBegin();
+  profileReset();
+}
+
+void profileReset() {
+  for (uint8_t i = 0; i < PROF_SECTIONS; i++) {
+    table[i].count = 0;
+    table[i].total = 0;
+    table[i].min = 0xFFFFFFFFUL;
+    table[i].max = 0;
+  }
+}
+
+// may be called from interrupt context, so keep it short
+void profileRecord(uint8_t section, uint32_t ticks) {
+  profileStat &s = table[section];
+  s.count++;
+  s.total += ticks;
+  if (ticks < s.min) s.min = ticks;
+  if (ticks > s.max) s.max = ticks;
+}
+
+// prints the table over serial, times in HAL cycle counter ticks
+void profileDump() {
+  char buffer[80];
+  halPrint("Profile (ticks per us: ");
+  halPrint((long)HAL_CYCLES_PER_US);
+  halPrintln(")");
+
+  for (uint8_t i = 0; i < PROF_SECTIONS; i++) {
+    halInterruptsOff();
+    profileStat s = table[i];
+    halInterruptsOn();
+
+    if (s.count == 0) continue;
+    snprintf(buffer, sizeof(buffer), "%-10s n: %lu min: %lu max: %lu mean: %lu",
+             sectionNames[i], (unsigned long)s.count, (unsigned long)s.min,
+             (unsigned long)s.max, (unsigned long)(s.total / s.count));
+    halPrintln(buffer);
+  }
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// hot path profiling
+// PROFILE_SCOPE(section) times the rest of the enclosing block with the
+// HAL cycle counter (Timer3 on the board) and keeps count, min, max and
+// total per section in a static table. Build with -DPROFILE_ENABLED=1
+// to turn it on; otherwise every macro compiles to nothing.
+
+#include <stdint.h>
+#include "hal.h"
+
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED 0
+#endif
+
+enum profileSection {
+    PROF_SAMPLE_ISR,   // accelerometer sampling interrupt
+    PROF_SPI_BURST,    // LIS3DH output / FIFO read
+    PROF_SPI_SAMPLE,   // one sample of a FIFO read, SPI only
+    PROF_FILTER,       // moving average + store
+    PROF_MATCHER,      // key/unlock comparison
+    PROF_SCREEN,       // fingerprint pre-screen
+    PROF_NEO_SHOW,     // NeoPixel transmit
+    PROF_DUMP,         // serial buffer dumps
+    PROF_SECTIONS
+};
+
+struct profileStat {
+    uint32_t count;
+    uint32_t total;
+    uint32_t min;
+    uint32_t max;
+};
+
+#if PROFILE_ENABLED
+
+void profileInit();
+void profileRecord(uint8_t section, uint32_t ticks);
+void profileDump();
+void profileReset();
+
+// records the lifetime of the object into its section
+class profileScope {
+public:
+    profileScope(uint8_t s) : section(s), start(halCycleCount()) {}
+    ~profileScope() { profileRecord(section, halCycleCount() - start); }
+private:
+    uint8_t section;
+    uint32_t start;
+};
+
+#define PROFILE_INIT() profileInit()
+#define PROFILE_SCOPE(s) profileScope _profileScope(s)
+#define PROFILE_DUMP() profileDump()
+
+#else
+
+#define PROFILE_INIT() ((void)0)
+#define PROFILE_SCOPE(s) ((void)0)
+#define PROFILE_DUMP() ((void)0)
+
+#endif
+
+#endif
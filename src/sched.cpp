@@ -0,0 +1,52 @@
+#include "sched.h"
+#include "hal.h"
+
+struct task {
+  schedTask fn;       // NULL if the slot is free
+  uint16_t period;    // 0 for one shot tasks
+  uint32_t due;       // halMillis() at which the task runs next
+};
+
+static task tasks[SCHED_MAX_TASKS];
+
+static int8_t schedAdd(schedTask fn, uint16_t delayMs, uint16_t periodMs) {
+  for (int8_t i = 0; i < SCHED_MAX_TASKS; i++) {
+    if (!tasks[i].fn) {
+      tasks[i].fn = fn;
+      tasks[i].period = periodMs;
+      tasks[i].due = halMillis() + delayMs;
+      return i;
+    }
+  }
+  return -1;
+}
+
+int8_t schedEvery(schedTask fn, uint16_t periodMs) {
+  return schedAdd(fn, periodMs, periodMs);
+}
+
+int8_t schedAfter(schedTask fn, uint16_t delayMs) {
+  return schedAdd(fn, delayMs, 0);
+}
+
+void schedCancel(int8_t id) {
+  if (id >= 0 && id < SCHED_MAX_TASKS) {
+    tasks[id].fn = 0;
+  }
+}
+
+void schedRun() {
+  uint32_t now = halMillis();
+  for (uint8_t i = 0; i < SCHED_MAX_TASKS; i++) {
+    schedTask fn = tasks[i].fn;
+    // signed difference handles the millis() wrap
+    if (!fn || (int32_t)(now - tasks[i].due) < 0) continue;
+
+    if (tasks[i].period) {
+      tasks[i].due += tasks[i].period;
+    } else {
+      tasks[i].fn = 0;
+    }
+    fn();
+  }
+}
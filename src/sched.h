@@ -0,0 +1,26 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+// millis based cooperative scheduler
+// tasks run from schedRun() in loop(), never from interrupts, and must
+// return quickly. A fixed table of SCHED_MAX_TASKS slots, no heap.
+
+#include <stdint.h>
+
+#define SCHED_MAX_TASKS 6
+
+typedef void (*schedTask)();
+
+// runs fn every periodMs, returns a task id or -1 if the table is full
+int8_t schedEvery(schedTask fn, uint16_t periodMs);
+
+// runs fn once after delayMs, returns a task id or -1 if the table is full
+int8_t schedAfter(schedTask fn, uint16_t delayMs);
+
+// stops a task, ignores -1
+void schedCancel(int8_t id);
+
+// runs every task that is due
+void schedRun();
+
+#endif
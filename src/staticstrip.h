@@ -0,0 +1,180 @@
+#ifndef STATICSTRIP_H
+#define STATICSTRIP_H
+
+#include <colorlib.h>
+#include <neotransmit.h>
+
+/*!
+  @brief   Compile time NeoPixel strip. Same API as colorlib, but the
+           length, output port/bit and color order are template
+           parameters: pixel bytes live in a static array (no malloc),
+           byte offsets are constants and the pixel path has no layout
+           branches. Use colorlib when any of these is only known at
+           runtime.
+  @tparam  N      Number of pixels.
+  @tparam  Port   Output port, NEO_PORTB/C/D/F.
+  @tparam  Bit    Output bit within the port (Arduino pin 17 is PB0).
+  @tparam  Order  Color order and speed, as for colorlib (NEO_GRB...).
+*/
+template <uint16_t N, uint8_t Port, uint8_t Bit,
+          neoPixelType Order = NEO_GRB + NEO_KHZ800>
+class StaticStrip {
+public:
+    static constexpr uint8_t wOffset = (Order >> 6) & 0b11;
+    static constexpr uint8_t rOffset = (Order >> 4) & 0b11;
+    static constexpr uint8_t gOffset = (Order >> 2) & 0b11;
+    static constexpr uint8_t bOffset =  Order       & 0b11;
+    static constexpr uint8_t bytesPerPixel = (wOffset == rOffset) ? 3 : 4;
+    static constexpr uint16_t numBytes = N * bytesPerPixel;
+    static constexpr uint8_t pinMask = 1 << Bit;
+
+    StaticStrip(void)
+        : brightness(0), gammaOn(false), endTime(0), dirty(true),
+          framesSent(0), framesSkipped(0) {
+        memset(pixels, 0, sizeof(pixels));
+    }
+
+    /*!
+      @brief   Configure NeoPixel pin for output.
+    */
+    void begin(void) {
+#ifdef __AVR__
+        _SFR_IO8(Port - 1) |= pinMask; // DDRx
+        _SFR_IO8(Port) &= ~pinMask;
+#endif
+    }
+
+    /*!
+      @brief   Transmit the pixel buffer, skipped if nothing changed since
+               the last transmit. Brightness and gamma are applied here.
+    */
+    void show(void) {
+        if (!dirty) {
+            framesSkipped++;
+            return;
+        }
+
+        uint8_t *out = pixels;
+        if (brightness || gammaOn) {
+            colorlib::scale(frame, pixels, numBytes, brightness, gammaOn);
+            out = frame;
+        }
+
+        while (!canShow());
+
+        halInterruptsOff(); // Need 100% focus on instruction timing
+#ifdef __AVR__
+        neoTransmit<Port>(pinMask, out, numBytes);
+#else
+        (void)out;
+#endif
+        halInterruptsOn();
+
+        endTime = halMicros(); // Save EOD time for latch on next call
+        dirty = false;
+        framesSent++;
+    }
+
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+        if (n < N) {
+            fillRange(colorlib::Color(r, g, b), n, n + 1);
+        }
+    }
+
+    void setPixelColor(uint16_t n, uint32_t c) {
+        if (n < N) {
+            fillRange(c, n, n + 1);
+        }
+    }
+
+    /*!
+      @brief   Fill all or part of the strip with a color.
+      @param   c      32-bit color value (see colorlib::Color()).
+      @param   first  Index of first pixel to fill, starting from 0.
+      @param   count  Number of pixels to fill, 0 (default) fills to the end.
+    */
+    void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0) {
+        if (first >= N) return;
+        uint16_t end = N;
+        if (count && count < N - first) end = first + count;
+        fillRange(c, first, end);
+    }
+
+    /*!
+      @brief   Fill the whole NeoPixel strip with 0 / black / off.
+    */
+    void clear(void) {
+        fill(0);
+    }
+
+    /*!
+      @brief   Adjust output brightness, O(1) and lossless
+               (see colorlib::setBrightness()).
+    */
+    void setBrightness(uint8_t b) {
+        uint8_t newBrightness = b + 1;
+        if (newBrightness != brightness) {
+            brightness = newBrightness;
+            dirty = true;
+        }
+    }
+
+    /*!
+      @brief   Enable or disable gamma correction of the transmitted colors.
+    */
+    void setGamma(bool on) {
+        if (on != gammaOn) {
+            gammaOn = on;
+            dirty = true;
+        }
+    }
+
+    bool canShow(void) {
+        uint32_t now = halMicros();
+        if (endTime > now) {
+            endTime = now;
+        }
+        return (now - endTime) >= 300L;
+    }
+
+    uint16_t numPixels(void) const { return N; }
+    uint32_t getFramesSent(void) const { return framesSent; }
+    uint32_t getFramesSkipped(void) const { return framesSkipped; }
+
+protected:
+    // order the bytes once, then copy the pattern through [first, end)
+    void fillRange(uint32_t c, uint16_t first, uint16_t end) {
+        uint8_t r = (uint8_t)(c >> 16);
+        uint8_t g = (uint8_t)(c >>  8);
+        uint8_t b = (uint8_t)c;
+        uint8_t w = (uint8_t)(c >> 24);
+
+        uint8_t pattern[4];
+        pattern[wOffset] = w;    // overwritten by R below on RGB strips
+        pattern[rOffset] = r;
+        pattern[gOffset] = g;
+        pattern[bOffset] = b;
+
+        uint8_t  changed = 0;
+        uint8_t *p = &pixels[first * bytesPerPixel];
+        for (uint16_t i = first; i < end; i++) {
+            for (uint8_t k = 0; k < bytesPerPixel; k++) {
+                changed |= p[k] ^ pattern[k];
+                p[k] = pattern[k];
+            }
+            p += bytesPerPixel;
+        }
+        if (changed) dirty = true;
+    }
+
+    uint8_t pixels[numBytes];   ///< Unscaled LED colors, 3 or 4 bytes each
+    uint8_t frame[numBytes];    ///< Scaled transmit frame
+    uint8_t brightness;         ///< Strip brightness 0-255 (stored as +1)
+    bool gammaOn;               ///< gamma-correct in show()
+    uint32_t endTime;           ///< Latch timing reference
+    bool dirty;                 ///< pixels changed since the last show()
+    uint32_t framesSent;        ///< show() calls that transmitted
+    uint32_t framesSkipped;     ///< show() calls skipped, nothing changed
+};
+
+#endif
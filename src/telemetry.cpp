@@ -0,0 +1,45 @@
+#include "telemetry.h"
+#include "cobs.h"
+#include "hal.h"
+
+static uint8_t sequence = 0;
+
+static void putInt16(uint8_t *p, int16_t v) {
+  p[0] = (uint16_t)v & 0xFF;
+  p[1] = (uint16_t)v >> 8;
+}
+
+void telemetrySendCapture(uint8_t type, const packedSample *samples,
+                          uint16_t length) {
+  // frame[0] is the COBS code byte, the record starts at frame[1]
+  // and frame[len + 1] is the closing delimiter
+  uint8_t frame[TELEM_MAX_RECORD + 2];
+  static const uint8_t delimiter = 0;
+
+  for (uint16_t first = 0; first < length; first += TELEM_CHUNK) {
+    uint8_t count = (length - first < TELEM_CHUNK) ? length - first : TELEM_CHUNK;
+    uint8_t *record = frame + 1;
+
+    record[0] = type;
+    record[1] = sequence++;
+    record[2] = first & 0xFF;
+    record[3] = first >> 8;
+    record[4] = count;
+    uint8_t *p = record + TELEM_HEADER;
+    for (uint8_t i = 0; i < count; i++) {
+      const packedSample &s = samples[first + i];
+      putInt16(p, sampleValue(s.x));
+      putInt16(p + 2, sampleValue(s.y));
+      putInt16(p + 4, sampleValue(s.z));
+      p += TELEM_SAMPLE_BYTES;
+    }
+    uint8_t len = p - record;
+    record[len] = crc8(record, len);
+    len++;
+
+    cobsEncodeInPlace(frame, len);
+    frame[len + 1] = 0;
+    halSerialWrite(&delimiter, 1);
+    halSerialWrite(frame, len + 2);
+  }
+}
@@ -0,0 +1,43 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+// binary telemetry stream
+// captures go out as COBS framed records, each wrapped in 0x00 delimiters
+// so plain text printed in between never corrupts a record:
+//
+//   byte 0     type (TELEM_*)
+//   byte 1     sequence number, +1 per record
+//   byte 2..3  index of the first sample, little endian
+//   byte 4     sample count n (at most TELEM_CHUNK)
+//   byte 5..   n samples as little endian int16 x, y, z
+//   last byte  CRC-8 (poly 0x07) over everything before it
+
+#include <stdint.h>
+#include <stddef.h>
+#include "capture.h"
+
+#define TELEM_KEY 1        // key capture samples
+#define TELEM_UNLOCK 2     // unlock capture samples
+
+#define TELEM_HEADER 5
+#define TELEM_CHUNK 25     // samples per record
+#define TELEM_SAMPLE_BYTES 6
+#define TELEM_MAX_RECORD (TELEM_HEADER + TELEM_CHUNK * TELEM_SAMPLE_BYTES + 1)
+
+// sends a capture as ceil(length / TELEM_CHUNK) records, the samples
+// go out dequantized (sampleValue()) so the record format is unchanged
+void telemetrySendCapture(uint8_t type, const packedSample *samples,
+                          uint16_t length);
+
+inline uint8_t crc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *data++;
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+#endif
@@ -0,0 +1,181 @@
+// colorlib benchmark on the host (see colorlib.h)
+//
+// for every strip length below, writes BENCH_COLORS random colors to an
+// RGB strip, one frame per color, at brightness BENCH_BRIGHTNESS, and
+// times each way of writing (and showing) the frame. One CSV line per
+// stage and length on stdout:
+//
+//   stage         fill: fill(c)
+//                 set: clear() then setPixelColor() for every pixel
+//                 show: fill(c) then show(), scaled into the frame
+//                 show_gamma: the same with setGamma(true)
+//                 prescale: the old way, c scaled once in fill() and the
+//                 stored colors sent as they are (full brightness)
+//   pixels        strip length
+//   ns_per_frame  one frame, best of BENCH_RUNS runs over all colors
+//
+// every frame of fill and set must leave the same stored colors, and
+// show must send the same bytes as prescale (show_gamma: gamma8() of the
+// colors, then the brightness multiply). A mismatch is reported on stderr
+// and exits 1.
+//
+//   pio run -e colorlib_bench
+//   .pio/build/colorlib_bench/program [-s seed] > bench.csv
+#include "../colorlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#define BENCH_RUNS 5
+#define BENCH_COLORS 1000
+#define BENCH_BRIGHTNESS 15
+
+static const uint16_t stripLengths[] = {10, 30, 60, 150};
+
+// the only hal calls colorlib makes. The clock jumps past the 300us latch
+// on every read, so show() never waits and only its own work is timed.
+static uint32_t nowUs;
+
+uint32_t halMicros() {
+  return nowUs += 1000;
+}
+
+void halInterruptsOff() {}
+
+void halInterruptsOn() {}
+
+// colorlib with its stored colors and last sent frame visible
+class benchStrip : public colorlib {
+public:
+  benchStrip(uint16_t n) : colorlib(n) {}
+  const uint8_t *stored() const { return pixels; }
+  const uint8_t *sent() const { return (brightness || gammaOn) ? frame : pixels; }
+  uint16_t bytes() const { return numBytes; }
+};
+
+static double seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t randomColor(uint32_t &state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state & 0xFFFFFF;
+}
+
+enum benchStage { STAGE_FILL, STAGE_SET, STAGE_SHOW, STAGE_SHOW_GAMMA, STAGE_PRESCALE };
+static const char *stageNames[] = {"fill", "set", "show", "show_gamma", "prescale"};
+
+static void setupStrip(benchStrip &strip, benchStage stage) {
+  strip.begin();
+  strip.setBrightness(stage == STAGE_PRESCALE ? 255 : BENCH_BRIGHTNESS);
+  strip.setGamma(stage == STAGE_SHOW_GAMMA);
+}
+
+// the fill-time multiply colorlib did before show() scaled the frame
+static uint8_t prescale(uint8_t v) {
+  return (v * (uint8_t)(BENCH_BRIGHTNESS + 1)) >> 8;
+}
+
+static void writeFrame(benchStrip &strip, benchStage stage, uint32_t c, uint16_t n) {
+  switch (stage) {
+    case STAGE_FILL:
+      strip.fill(c);
+      break;
+    case STAGE_SET:
+      strip.clear();
+      for (uint16_t i = 0; i < n; i++) {
+        strip.setPixelColor(i, (uint8_t)(c >> 16), (uint8_t)(c >> 8), (uint8_t)c);
+      }
+      break;
+    case STAGE_SHOW:
+    case STAGE_SHOW_GAMMA:
+      strip.fill(c);
+      strip.show();
+      break;
+    case STAGE_PRESCALE:
+      strip.fill(colorlib::Color(prescale(c >> 16), prescale(c >> 8), prescale(c)));
+      strip.show();
+      break;
+  }
+}
+
+// ns per frame, best of BENCH_RUNS
+static double timeStage(benchStage stage, uint16_t n, const std::vector<uint32_t> &colors) {
+  benchStrip strip(n);
+  setupStrip(strip, stage);
+  double best = 1e30;
+  for (uint8_t run = 0; run < BENCH_RUNS; run++) {
+    double t0 = seconds();
+    for (size_t i = 0; i < colors.size(); i++) writeFrame(strip, stage, colors[i], n);
+    double t = seconds() - t0;
+    if (t < best) best = t;
+  }
+  return best * 1e9 / colors.size();
+}
+
+// frame by frame, set stores what fill stores, show and show_gamma send
+// what the old fill-time scaling would have sent
+static bool checkStages(uint16_t n, const std::vector<uint32_t> &colors) {
+  benchStrip fill(n), set(n), show(n), gamma(n), old(n);
+  setupStrip(fill, STAGE_FILL);
+  setupStrip(set, STAGE_SET);
+  setupStrip(show, STAGE_SHOW);
+  setupStrip(gamma, STAGE_SHOW_GAMMA);
+  setupStrip(old, STAGE_PRESCALE);
+  std::vector<uint8_t> expect(fill.bytes());
+  for (size_t i = 0; i < colors.size(); i++) {
+    uint32_t c = colors[i];
+    writeFrame(fill, STAGE_FILL, c, n);
+    writeFrame(set, STAGE_SET, c, n);
+    writeFrame(show, STAGE_SHOW, c, n);
+    writeFrame(gamma, STAGE_SHOW_GAMMA, c, n);
+    writeFrame(old, STAGE_PRESCALE, c, n);
+    for (uint16_t b = 0; b < fill.bytes(); b++) {
+      expect[b] = prescale(colorlib::gamma8(fill.stored()[b]));
+    }
+    const char *bad = NULL;
+    if (memcmp(set.stored(), fill.stored(), fill.bytes()) != 0) bad = "set";
+    else if (memcmp(show.sent(), old.sent(), fill.bytes()) != 0) bad = "show";
+    else if (memcmp(gamma.sent(), &expect[0], fill.bytes()) != 0) bad = "show_gamma";
+    if (bad) {
+      fprintf(stderr, "%s: %u pixels, color %06x differs\n", bad, n, c);
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  uint32_t seed = 1;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:")) != -1) {
+    switch (opt) {
+      case 's': seed = strtoul(optarg, 0, 0); break;
+      default: optind = argc + 1; break;
+    }
+  }
+  if (optind != argc) {
+    fprintf(stderr, "usage: %s [-s seed]\n", argv[0]);
+    return 2;
+  }
+
+  uint32_t state = seed ? seed : 1;
+  std::vector<uint32_t> colors(BENCH_COLORS);
+  for (size_t i = 0; i < colors.size(); i++) colors[i] = randomColor(state);
+
+  printf("stage,pixels,ns_per_frame\n");
+  for (size_t l = 0; l < sizeof(stripLengths) / sizeof(stripLengths[0]); l++) {
+    uint16_t n = stripLengths[l];
+    if (!checkStages(n, colors)) return 1;
+    for (int s = 0; s < (int)(sizeof(stageNames) / sizeof(stageNames[0])); s++) {
+      printf("%s,%u,%.1f\n", stageNames[s], n, timeStage((benchStage)s, n, colors));
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,446 @@
+// Matcher benchmark on synthetic gestures (see synth.h)
+//
+// for every capture length (TIMER_COUNT) and moving average window
+// (WINDOW_SIZE) below: renders key/unlock pairs at ACCEL_ODR, records
+// them through the capture filter, then times every matcher on the
+// genuine pairs (key i, unlock i) and impostor pairs (key i, unlock i+1).
+// One CSV line per stage and setting on stdout:
+//
+//   stage           filter, float, fixed, dtw or stream
+//   timer_count     samples per capture at SAMPLE_RATE
+//   window_size     moving average window
+//   ns_per_call     filter: one raw sample, stream: one unlock sample,
+//                   float/fixed/dtw: one decision (lag alignment included)
+//   ns_per_capture  every call for one capture
+//   ram_bytes       working memory: the filter state; for float, fixed and
+//                   dtw both captures and their state; for stream the per
+//                   key state (the key comes from EEPROM, the unlock is
+//                   never stored). Host sizeof, the AVR has no padding.
+//   genuine_pass, impostor_pass  fraction of the pairs that passed
+//
+// timings are the best of BENCH_RUNS runs over all pairs.
+//
+// -m agree: float vs fixed point ratio test on random traces (-n of them,
+// TIMER_COUNT samples) with zero key values and unlocks scattered around
+// the 50% tolerance, no lag alignment. One line per matcher:
+//
+//   stage           float or fixed
+//   trials, ns_per_call, pass_rate
+//   disagree        decisions that differ between the two
+//
+// -m warp: DTW at TIMER_COUNT and WINDOW_SIZE on -p synthetic keys.
+// Its worst case (every key against itself, no early exit), then unlocks
+// performed exactly 0.9x, 1x and 1.1x as fast as their key, DTW against
+// the aligned fixed point test:
+//
+//   stage           worst or stretch
+//   stretch, dtw_ns_per_call, dtw_pass, fixed_pass
+//
+//   pio run -e matcher_bench
+//   .pio/build/matcher_bench/program [-p pairs] [-s seed] > bench.csv
+//   .pio/build/matcher_bench/program -m agree [-n trials] [-s seed]
+//   .pio/build/matcher_bench/program -m warp [-p pairs] [-s seed]
+#include "../pipeline.h"
+#include "synth.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#define BENCH_RUNS 5
+#define AGREE_BATCH 1000   // traces generated, then timed, at a time
+#define WARP_CALLS 20000   // worst case DTW calls per run
+
+// capture lengths; at most 255, key lengths and the alignment counts are
+// 8 bit like on the device
+static const uint8_t timerCounts[] = {25, 50, 75, 100, 150, 200, 250};
+
+struct benchPair {
+    std::vector<traceSample> key;
+    std::vector<traceSample> unlock;
+};
+
+static double seconds() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void emit(const char *stage, uint8_t timerCount, uint8_t windowSize,
+                 double nsPerCall, double callsPerCapture, size_t ramBytes,
+                 int genuine, int impostor, int pairs) {
+  printf("%s,%u,%u,%.1f,%.1f,%lu,", stage, timerCount, windowSize,
+         nsPerCall, nsPerCall * callsPerCapture, (unsigned long)ramBytes);
+  if (pairs) printf("%.3f,%.3f\n", (double)genuine / pairs, (double)impostor / pairs);
+  else printf(",\n");
+}
+
+// -------------- MATCHERS -------------- //
+static bool runFloat(const gesture &key, const gesture &unlock) {
+  gesture k, u;
+  matchShift(key, unlock, matchAlign(key, unlock), &k, &u);
+  return matchFloat(k, u);
+}
+
+static bool runFixed(const gesture &key, const gesture &unlock) {
+  gesture k, u;
+  matchShift(key, unlock, matchAlign(key, unlock), &k, &u);
+  return matchFixed(k, u);
+}
+
+static bool runDtw(const gesture &key, const gesture &unlock) {
+  return matchDtw(key, unlock);
+}
+
+// one key slot of the firmware's streaming match: every unlock sample
+// goes to all lags as it arrives (matchUnlockSample() in main.cpp), the
+// decision is the check validateSequence() makes at the end. Stops at
+// the first sample no lag can pass, like a slot that drops out.
+static bool runStream(const gesture &key, const gesture &unlock, uint32_t *calls) {
+  matchStream m[MATCH_LAGS];
+  matchCorr c;
+  for (uint8_t k = 0; k < MATCH_LAGS; k++) matchStreamBegin(m[k]);
+  matchCorrBegin(c, matchMean(key));
+
+  for (uint16_t j = 0; j < unlock.length; j++) {
+    ++*calls;
+    bool alive = false;
+    for (int8_t lag = -MATCH_LAG_MAX; lag <= MATCH_LAG_MAX; lag++) {
+      int16_t i = (int16_t)j - lag;
+      if (i < 0 || i >= key.length) {
+        alive = alive || matchStreamAlive(m[lag + MATCH_LAG_MAX]);
+        continue;
+      }
+      if (i >= MATCH_START && j >= MATCH_START) {
+        matchCorrPush(c, lag, key.samples[i], unlock.samples[j]);
+      }
+      if (matchStreamPush(m[lag + MATCH_LAG_MAX], key.samples[i], unlock.samples[j])) {
+        alive = true;
+      }
+    }
+    if (!alive) return false;
+  }
+
+  int8_t lag = matchCorrBest(c);
+  int16_t keyLength = key.length;
+  int16_t unlockLength = unlock.length;
+  if (lag > 0) unlockLength -= lag;
+  if (lag < 0) keyLength += lag;
+  return matchStreamAlive(m[lag + MATCH_LAG_MAX]) && unlockLength > 0 &&
+         keyLength > 0 && matchLengths(keyLength, unlockLength);
+}
+
+// -------------- BENCHMARK -------------- //
+// times a buffered matcher over every genuine and impostor pair
+static void benchMatcher(const char *stage, bool (*match)(const gesture &, const gesture &),
+                         const std::vector<gesture> &keys,
+                         const std::vector<gesture> &unlocks,
+                         uint8_t timerCount, uint8_t windowSize, size_t state) {
+  size_t n = keys.size();
+  int genuine = 0, impostor = 0;
+  double best = 1e30;
+  for (int run = 0; run < BENCH_RUNS; run++) {
+    genuine = impostor = 0;
+    double start = seconds();
+    for (size_t p = 0; p < n; p++) {
+      genuine += match(keys[p], unlocks[p]);
+      impostor += match(keys[p], unlocks[(p + 1) % n]);
+    }
+    double elapsed = seconds() - start;
+    if (elapsed < best) best = elapsed;
+  }
+  size_t buffers = 2 * timerCount * sizeof(packedSample);
+  emit(stage, timerCount, windowSize, best * 1e9 / (2 * n), 1,
+       buffers + state, genuine, impostor, n);
+}
+
+static void benchStream(const std::vector<gesture> &keys,
+                        const std::vector<gesture> &unlocks,
+                        uint8_t timerCount, uint8_t windowSize) {
+  size_t n = keys.size();
+  int genuine = 0, impostor = 0;
+  uint32_t calls = 0;
+  double best = 1e30;
+  for (int run = 0; run < BENCH_RUNS; run++) {
+    genuine = impostor = 0;
+    calls = 0;
+    double start = seconds();
+    for (size_t p = 0; p < n; p++) {
+      genuine += runStream(keys[p], unlocks[p], &calls);
+      impostor += runStream(keys[p], unlocks[(p + 1) % n], &calls);
+    }
+    double elapsed = seconds() - start;
+    if (elapsed < best) best = elapsed;
+  }
+  // per unlock sample actually pushed, per capture as if none dropped out
+  size_t state = MATCH_LAGS * sizeof(matchStream) + sizeof(matchCorr) + 1;
+  emit("stream", timerCount, windowSize, calls ? best * 1e9 / calls : 0,
+       timerCount, state, genuine, impostor, n);
+}
+
+// records every trace through a captureFilter with window W, times it
+// and benchmarks the matchers on the result
+template <uint8_t W>
+static void benchWindow(const std::vector<benchPair> &pairs, uint8_t timerCount) {
+  typedef captureFilter<DECIMATION, CIC_ORDER, W> filterType;
+  size_t n = pairs.size();
+  std::vector<packedSample> samples(2 * n * timerCount);
+  uint32_t raw = pairs[0].key.size();
+
+  double best = 1e30;
+  for (int run = 0; run < BENCH_RUNS; run++) {
+    double start = seconds();
+    for (size_t t = 0; t < 2 * n; t++) {
+      const traceSample *in = (t & 1) ? &pairs[t / 2].unlock[0] : &pairs[t / 2].key[0];
+      packedSample *out = &samples[t * timerCount];
+      filterType filter;
+      uint16_t length = 0;
+      for (uint32_t i = 0; i < raw && length < timerCount; i++) {
+        if (filter.update(in[i].x, in[i].y, in[i].z, &out[length])) length++;
+      }
+    }
+    double elapsed = seconds() - start;
+    if (elapsed < best) best = elapsed;
+  }
+  emit("filter", timerCount, W, best * 1e9 / (2 * n * raw), raw,
+       sizeof(filterType), 0, 0, 0);
+
+  std::vector<gesture> keys(n), unlocks(n);
+  for (size_t p = 0; p < n; p++) {
+    keys[p].samples = &samples[2 * p * timerCount];
+    keys[p].length = timerCount;
+    unlocks[p].samples = &samples[(2 * p + 1) * timerCount];
+    unlocks[p].length = timerCount;
+  }
+  benchMatcher("float", runFloat, keys, unlocks, timerCount, W, sizeof(matchCorr));
+  benchMatcher("fixed", runFixed, keys, unlocks, timerCount, W,
+               sizeof(matchCorr) + sizeof(matchStream));
+  benchMatcher("dtw", runDtw, keys, unlocks, timerCount, W,
+               2 * MATCH_DTW_WIDTH * sizeof(uint32_t));
+  benchStream(keys, unlocks, timerCount, W);
+}
+
+// -------------- FLOAT VS FIXED -------------- //
+// a key value: one in ten is zero (no tolerance), the rest anywhere
+static int8_t agreeKey(synthRandom &r) {
+  if (synthNext(r) % 10 == 0) return 0;
+  return (int8_t)(synthNext(r) >> 24);
+}
+
+// the key value off by up to 67% either way, plus one LSB of noise:
+// about half the traces pass
+static int8_t agreeUnlock(synthRandom &r, int8_t k) {
+  int16_t v = k + (int16_t)lround(k * synthUniform(r, -0.67, 0.67)) +
+              (int16_t)(synthNext(r) % 3) - 1;
+  if (v > 127) v = 127;
+  if (v < -128) v = -128;
+  return (int8_t)v;
+}
+
+static void benchAgree(long trials, unsigned long seed) {
+  synthRandom r;
+  synthSeed(r, seed);
+  std::vector<packedSample> keys(AGREE_BATCH * TIMER_COUNT);
+  std::vector<packedSample> unlocks(AGREE_BATCH * TIMER_COUNT);
+  bool floatPass[AGREE_BATCH], fixedPass[AGREE_BATCH];
+  double floatTime = 0, fixedTime = 0;
+  long floatPasses = 0, fixedPasses = 0, disagree = 0;
+
+  for (long done = 0; done < trials; done += AGREE_BATCH) {
+    long n = trials - done < AGREE_BATCH ? trials - done : AGREE_BATCH;
+    for (long i = 0; i < n * TIMER_COUNT; i++) {
+      int8_t *k = &keys[i].x;
+      int8_t *u = &unlocks[i].x;
+      for (uint8_t a = 0; a < 3; a++) {
+        k[a] = agreeKey(r);
+        u[a] = agreeUnlock(r, k[a]);
+      }
+    }
+
+    double start = seconds();
+    for (long t = 0; t < n; t++) {
+      gesture key = {&keys[t * TIMER_COUNT], TIMER_COUNT};
+      gesture unlock = {&unlocks[t * TIMER_COUNT], TIMER_COUNT};
+      floatPass[t] = matchFloat(key, unlock);
+    }
+    double middle = seconds();
+    for (long t = 0; t < n; t++) {
+      gesture key = {&keys[t * TIMER_COUNT], TIMER_COUNT};
+      gesture unlock = {&unlocks[t * TIMER_COUNT], TIMER_COUNT};
+      fixedPass[t] = matchFixed(key, unlock);
+    }
+    fixedTime += seconds() - middle;
+    floatTime += middle - start;
+
+    for (long t = 0; t < n; t++) {
+      floatPasses += floatPass[t];
+      fixedPasses += fixedPass[t];
+      disagree += floatPass[t] != fixedPass[t];
+    }
+  }
+
+  printf("stage,trials,ns_per_call,pass_rate,disagree\n");
+  printf("float,%ld,%.1f,%.4f,%ld\n", trials, floatTime * 1e9 / trials,
+         (double)floatPasses / trials, disagree);
+  printf("fixed,%ld,%.1f,%.4f,%ld\n", trials, fixedTime * 1e9 / trials,
+         (double)fixedPasses / trials, disagree);
+}
+
+// -------------- DTW TEMPO -------------- //
+// a raw trace through the device filter, TIMER_COUNT samples
+static void recordTrace(const traceSample *in, uint32_t raw, packedSample *out) {
+  sentryFilter filter;
+  uint16_t length = 0;
+  for (uint32_t i = 0; i < raw && length < TIMER_COUNT; i++) {
+    if (filter.update(in[i].x, in[i].y, in[i].z, &out[length])) length++;
+  }
+}
+
+// DTW against the aligned fixed point test on keys and unlocks performed
+// stretch times as fast, from the same shapes (noise aside)
+static void benchStretch(const std::vector<synthShape> &shapes, double stretch,
+                         synthRandom &r, double noise) {
+  long count = shapes.size();
+  uint32_t raw = (uint32_t)TIMER_COUNT * DECIMATION;
+  std::vector<traceSample> trace(raw);
+  std::vector<packedSample> keys(count * TIMER_COUNT);
+  std::vector<packedSample> unlocks(count * TIMER_COUNT);
+  for (long p = 0; p < count; p++) {
+    synthVariation v = {1, 0, 1, {0, 0, 0}, noise};
+    synthRender(shapes[p], v, r, raw, &trace[0]);
+    recordTrace(&trace[0], raw, &keys[p * TIMER_COUNT]);
+    v.stretch = stretch;
+    synthRender(shapes[p], v, r, raw, &trace[0]);
+    recordTrace(&trace[0], raw, &unlocks[p * TIMER_COUNT]);
+  }
+
+  int dtw = 0, fixed = 0;
+  double best = 1e30;
+  for (int run = 0; run < BENCH_RUNS; run++) {
+    dtw = 0;
+    double start = seconds();
+    for (long p = 0; p < count; p++) {
+      gesture k = {&keys[p * TIMER_COUNT], TIMER_COUNT};
+      gesture u = {&unlocks[p * TIMER_COUNT], TIMER_COUNT};
+      dtw += matchDtw(k, u);
+    }
+    double elapsed = seconds() - start;
+    if (elapsed < best) best = elapsed;
+  }
+  for (long p = 0; p < count; p++) {
+    gesture k = {&keys[p * TIMER_COUNT], TIMER_COUNT};
+    gesture u = {&unlocks[p * TIMER_COUNT], TIMER_COUNT};
+    fixed += runFixed(k, u);
+  }
+  printf("stretch,%.2f,%.1f,%.3f,%.3f\n", stretch, best * 1e9 / count,
+         (double)dtw / count, (double)fixed / count);
+}
+
+static void benchWarp(long count, unsigned long seed) {
+  static const double stretches[] = {0.9, 1.0, 1.1};
+  double noise = 20;  // the default trace_synth spread
+  uint32_t raw = (uint32_t)TIMER_COUNT * DECIMATION;
+
+  synthRandom r;
+  synthSeed(r, seed);
+  std::vector<synthShape> shapes(count);
+  for (long p = 0; p < count; p++) synthShapeMake(r, shapes[p]);
+
+  printf("stage,stretch,dtw_ns_per_call,dtw_pass,fixed_pass\n");
+
+  // a key against itself never goes over budget, every row is filled
+  std::vector<traceSample> trace(raw);
+  std::vector<packedSample> keys(count * TIMER_COUNT);
+  for (long p = 0; p < count; p++) {
+    synthVariation v = {1, 0, 1, {0, 0, 0}, noise};
+    synthRender(shapes[p], v, r, raw, &trace[0]);
+    recordTrace(&trace[0], raw, &keys[p * TIMER_COUNT]);
+  }
+  long calls = 0;
+  int dtw = 0, fixed = 0;
+  double best = 1e30;
+  for (int run = 0; run < BENCH_RUNS; run++) {
+    calls = dtw = 0;
+    double start = seconds();
+    while (calls < WARP_CALLS) {
+      for (long p = 0; p < count; p++, calls++) {
+        gesture key = {&keys[p * TIMER_COUNT], TIMER_COUNT};
+        dtw += matchDtw(key, key);
+      }
+    }
+    double elapsed = seconds() - start;
+    if (elapsed < best) best = elapsed;
+  }
+  for (long p = 0; p < count; p++) {
+    gesture key = {&keys[p * TIMER_COUNT], TIMER_COUNT};
+    fixed += runFixed(key, key);
+  }
+  printf("worst,1.00,%.1f,%.3f,%.3f\n", best * 1e9 / calls,
+         (double)dtw / calls, (double)fixed / count);
+
+  for (size_t s = 0; s < sizeof(stretches) / sizeof(stretches[0]); s++) {
+    benchStretch(shapes, stretches[s], r, noise);
+  }
+}
+
+int main(int argc, char **argv) {
+  long count = 32, trials = 200000;
+  unsigned long seed = 1;
+  const char *mode = "sweep";
+  int opt;
+  while ((opt = getopt(argc, argv, "p:s:m:n:")) != -1) {
+    if (opt == 'p') count = atol(optarg);
+    else if (opt == 's') seed = strtoul(optarg, 0, 0);
+    else if (opt == 'm') mode = optarg;
+    else if (opt == 'n') trials = atol(optarg);
+    else count = 0;
+  }
+  bool agree = !strcmp(mode, "agree");
+  bool warp = !strcmp(mode, "warp");
+  if (optind != argc || count < 2 || trials < 1 ||
+      !(agree || warp || !strcmp(mode, "sweep"))) {
+    fprintf(stderr, "usage: %s [-p pairs] [-s seed] > bench.csv\n"
+                    "       %s -m agree [-n trials] [-s seed]\n"
+                    "       %s -m warp [-p pairs] [-s seed]\n",
+            argv[0], argv[0], argv[0]);
+    return 2;
+  }
+  if (agree) {
+    benchAgree(trials, seed);
+    return 0;
+  }
+  if (warp) {
+    benchWarp(count, seed);
+    return 0;
+  }
+
+  // the default trace_synth spread
+  synthSpread spread = {0.08, 0.03, 0.15, 40, 20};
+
+  printf("stage,timer_count,window_size,ns_per_call,ns_per_capture,ram_bytes,"
+         "genuine_pass,impostor_pass\n");
+  for (size_t t = 0; t < sizeof(timerCounts); t++) {
+    uint8_t timerCount = timerCounts[t];
+    uint32_t raw = (uint32_t)timerCount * DECIMATION;
+
+    synthRandom r;
+    synthSeed(r, seed);
+    std::vector<benchPair> pairs(count);
+    for (long p = 0; p < count; p++) {
+      synthShape shape;
+      synthShapeMake(r, shape);
+      pairs[p].key.resize(raw);
+      pairs[p].unlock.resize(raw);
+      synthPair(shape, spread, r, raw, &pairs[p].key[0], &pairs[p].unlock[0]);
+    }
+
+    benchWindow<7>(pairs, timerCount);
+    benchWindow<15>(pairs, timerCount);
+    benchWindow<WINDOW_SIZE>(pairs, timerCount);
+    benchWindow<63>(pairs, timerCount);
+    benchWindow<127>(pairs, timerCount);
+  }
+  return 0;
+}
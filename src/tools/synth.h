@@ -0,0 +1,138 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+// deterministic synthetic gestures (host tools only)
+// a gesture shape is a few smooth sinusoids per axis under a raised
+// cosine envelope, on top of a static gravity vector, so the board is
+// still at the start and the end of every capture. Rendering a shape
+// with a variation (time stretch, amplitude, offset, noise) gives raw
+// LIS3DH samples (trace.h) at any rate and length. The same seed always
+// gives the same samples.
+
+#include <math.h>
+#include <stdint.h>
+#include "trace.h"
+
+#define SYNTH_PARTS 3          // sinusoids per axis
+#define SYNTH_FULL_SCALE 2000  // mg, the firmware's +-2g range
+#define SYNTH_MARGIN 0.15      // still part at each end, fraction of the length
+
+// xorshift32, never seeded with 0
+struct synthRandom {
+    uint32_t state;
+};
+
+inline void synthSeed(synthRandom &r, uint32_t seed) {
+    r.state = seed ? seed : 0x9E3779B9UL;
+}
+
+inline uint32_t synthNext(synthRandom &r) {
+    uint32_t x = r.state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return r.state = x;
+}
+
+// uniform in [lo, hi)
+inline double synthUniform(synthRandom &r, double lo, double hi) {
+    return lo + (hi - lo) * (synthNext(r) >> 8) * (1.0 / 16777216.0);
+}
+
+// zero mean, unit deviation (sum of four uniforms, close enough)
+inline double synthGauss(synthRandom &r) {
+    double s = 0;
+    for (uint8_t i = 0; i < 4; i++) s += synthUniform(r, -1.0, 1.0);
+    return s * 0.8660254;  // sqrt(3 / 4)
+}
+
+struct synthShape {
+    double gravity[3];             // mg, static orientation of the board
+    double amp[3][SYNTH_PARTS];    // mg
+    double cycles[3][SYNTH_PARTS]; // periods over the moving part
+    double phase[3][SYNTH_PARTS];  // radians
+};
+
+// how far a rendering departs from the shape
+struct synthVariation {
+    double stretch;    // time scale, 1.1 is a 10% slower performance
+    double delay;      // start of the motion moved by this fraction of the length
+    double amplitude;  // scale of the motion
+    double offset[3];  // mg added per axis (a tilted board)
+    double noise;      // mg rms white noise per sample
+};
+
+// the limits variations are drawn from, symmetric around the shape
+struct synthSpread {
+    double stretch;    // +- fraction, 0.1 draws 0.9..1.1
+    double delay;      // +- fraction of the length
+    double amplitude;  // +- fraction
+    double offset;     // +- mg per axis
+    double noise;      // mg rms (not drawn, used as is)
+};
+
+inline void synthShapeMake(synthRandom &r, synthShape &s) {
+    // a random direction for 1g, mostly face up
+    double z = synthUniform(r, 0.5, 1.0);
+    double a = synthUniform(r, 0, 2 * M_PI);
+    double xy = sqrt(1 - z * z);
+    s.gravity[0] = 1000 * xy * cos(a);
+    s.gravity[1] = 1000 * xy * sin(a);
+    s.gravity[2] = 1000 * z;
+    for (uint8_t i = 0; i < 3; i++) {
+        for (uint8_t p = 0; p < SYNTH_PARTS; p++) {
+            s.amp[i][p] = synthUniform(r, 100, 500) / (p + 1);
+            s.cycles[i][p] = synthUniform(r, 0.5, 2.5) * (p + 1);
+            s.phase[i][p] = synthUniform(r, 0, 2 * M_PI);
+        }
+    }
+}
+
+inline void synthVary(synthRandom &r, const synthSpread &spread, synthVariation &v) {
+    v.stretch = 1 + synthUniform(r, -spread.stretch, spread.stretch);
+    v.delay = synthUniform(r, -spread.delay, spread.delay);
+    v.amplitude = 1 + synthUniform(r, -spread.amplitude, spread.amplitude);
+    for (uint8_t i = 0; i < 3; i++) {
+        v.offset[i] = synthUniform(r, -spread.offset, spread.offset);
+    }
+    v.noise = spread.noise;
+}
+
+// the shape as recorded: count samples, the first SYNTH_MARGIN and the
+// last SYNTH_MARGIN of them still (before stretch and delay move the
+// motion). r only supplies the noise.
+inline void synthRender(const synthShape &s, const synthVariation &v,
+                        synthRandom &r, uint32_t count, traceSample *out) {
+    double moving = (1 - 2 * SYNTH_MARGIN) * count * v.stretch;
+    double start = (SYNTH_MARGIN + v.delay) * count;
+    for (uint32_t n = 0; n < count; n++) {
+        double t = moving > 0 ? (n - start) / moving : -1;  // 0..1 while moving
+        double envelope = (t > 0 && t < 1) ? 0.5 - 0.5 * cos(2 * M_PI * t) : 0;
+        int16_t xyz[3];
+        for (uint8_t i = 0; i < 3; i++) {
+            double mg = s.gravity[i] + v.offset[i] + v.noise * synthGauss(r);
+            for (uint8_t p = 0; p < SYNTH_PARTS; p++) {
+                mg += envelope * v.amplitude * s.amp[i][p] *
+                      sin(2 * M_PI * s.cycles[i][p] * t + s.phase[i][p]);
+            }
+            if (mg > SYNTH_FULL_SCALE - 1) mg = SYNTH_FULL_SCALE - 1;
+            if (mg < -SYNTH_FULL_SCALE) mg = -SYNTH_FULL_SCALE;
+            xyz[i] = (int16_t)lround(mg) * 16;  // left justified 12 bit
+        }
+        out[n].x = xyz[0];
+        out[n].y = xyz[1];
+        out[n].z = xyz[2];
+    }
+}
+
+// a key (the shape with noise only) and an unlock with a drawn variation
+inline void synthPair(const synthShape &s, const synthSpread &spread,
+                      synthRandom &r, uint32_t count,
+                      traceSample *key, traceSample *unlock) {
+    synthVariation v = {1, 0, 1, {0, 0, 0}, spread.noise};
+    synthRender(s, v, r, count, key);
+    synthVary(r, spread, v);
+    synthRender(s, v, r, count, unlock);
+}
+
+#endif
@@ -0,0 +1,63 @@
+// Host decoder for the binary telemetry stream (see telemetry.h)
+//
+// reads the raw serial stream on stdin and writes one CSV line per sample
+// to stdout. Anything between records that is not a valid frame (the
+// plain text status lines) is passed through to stderr.
+//
+//   pio run -e telemetry_decode
+//   .pio/build/telemetry_decode/program < capture.bin > capture.csv
+#include "../cobs.h"
+#include "../telemetry.h"
+#include <stdio.h>
+
+#define MAX_FRAME 1024
+
+static int16_t getInt16(const uint8_t *p) {
+  return (int16_t)(p[0] | (p[1] << 8));
+}
+
+// returns false if the frame is not a well formed record
+static bool emitRecord(const uint8_t *frame, size_t len) {
+  uint8_t record[MAX_FRAME];
+  size_t n = cobsDecode(frame, len, record);
+  if (n < TELEM_HEADER + 1) return false;
+  if (crc8(record, n - 1) != record[n - 1]) return false;
+
+  uint8_t type = record[0];
+  uint8_t seq = record[1];
+  uint16_t first = record[2] | (record[3] << 8);
+  uint8_t count = record[4];
+  if (n != TELEM_HEADER + count * TELEM_SAMPLE_BYTES + 1u) return false;
+
+  const char *name = (type == TELEM_KEY) ? "key" : (type == TELEM_UNLOCK) ? "unlock" : "unknown";
+  const uint8_t *p = record + TELEM_HEADER;
+  for (uint8_t i = 0; i < count; i++) {
+    printf("%s,%u,%u,%d,%d,%d\n", name, seq, first + i,
+           getInt16(p), getInt16(p + 2), getInt16(p + 4));
+    p += TELEM_SAMPLE_BYTES;
+  }
+  return true;
+}
+
+int main() {
+  uint8_t frame[MAX_FRAME];
+  size_t len = 0;
+  bool overflow = false;
+  int c;
+
+  printf("capture,seq,index,x,y,z\n");
+  while ((c = getchar()) != EOF) {
+    if (c != 0) {
+      if (len < MAX_FRAME) frame[len++] = c;
+      else overflow = true;
+      continue;
+    }
+    if (len > 0 && (overflow || !emitRecord(frame, len))) {
+      fwrite(frame, 1, len, stderr);
+    }
+    len = 0;
+    overflow = false;
+  }
+  if (len > 0) fwrite(frame, 1, len, stderr);
+  return 0;
+}
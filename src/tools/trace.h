@@ -0,0 +1,122 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// recorded LIS3DH trace files (host tools only)
+// raw accelerometer output as the firmware reads it, before any
+// filtering, so a corpus can be replayed through the device pipeline.
+// Fixed width little endian records with no padding, laid out to be
+// mmap()ed and read in place:
+//
+//   traceFileHeader                 16 bytes
+//   count x { traceHeader           8 bytes
+//             length x XYZ int16    6 bytes per sample }
+//
+// samples stay 2 byte aligned, a traceHeader after an odd length does
+// not stay 4 byte aligned, so traceNext() copies each one out.
+//
+// samples are the left justified OUT_X/Y/Z register pairs at the file's
+// odr. A key trace is an enrollment, an unlock trace an attempt; the
+// gesture id says which key an attempt is genuine for (any other key
+// sees it as an impostor).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TRACE_MAGIC "SNTR"
+#define TRACE_VERSION 1
+
+#define TRACE_KEY 0
+#define TRACE_UNLOCK 1
+
+struct traceFileHeader {
+    char magic[4];       // TRACE_MAGIC
+    uint16_t version;    // TRACE_VERSION
+    uint16_t odr;        // raw sample rate (Hz)
+    uint32_t count;      // traces in the file
+    uint32_t reserved;
+};
+
+struct traceHeader {
+    uint16_t gesture;    // which gesture (and so which key) this is
+    uint8_t kind;        // TRACE_KEY or TRACE_UNLOCK
+    uint8_t reserved;
+    uint32_t length;     // samples that follow
+};
+
+struct traceSample {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+};
+
+static_assert(sizeof(traceFileHeader) == 16, "trace file header layout");
+static_assert(sizeof(traceHeader) == 8, "trace header layout");
+static_assert(sizeof(traceSample) == 6, "trace sample layout");
+
+// -------------- WRITING -------------- //
+// a header with count 0, patched by traceFinish()
+inline bool traceBegin(FILE *f, uint16_t odr) {
+    traceFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TRACE_MAGIC, 4);
+    h.version = TRACE_VERSION;
+    h.odr = odr;
+    return fwrite(&h, sizeof(h), 1, f) == 1;
+}
+
+inline bool traceAppend(FILE *f, uint16_t gesture, uint8_t kind,
+                        const traceSample *samples, uint32_t length) {
+    traceHeader h = {gesture, kind, 0, length};
+    return fwrite(&h, sizeof(h), 1, f) == 1 &&
+           fwrite(samples, sizeof(traceSample), length, f) == length;
+}
+
+inline bool traceFinish(FILE *f, uint32_t count) {
+    return fseek(f, offsetof(traceFileHeader, count), SEEK_SET) == 0 &&
+           fwrite(&count, sizeof(count), 1, f) == 1 &&
+           fflush(f) == 0;
+}
+
+// -------------- READING -------------- //
+// walks a mapped file: traceOpen() checks the header, then every
+// traceNext() hands out one record, its samples pointing into the mapping
+struct traceCursor {
+    const uint8_t *next;
+    const uint8_t *end;
+    uint32_t left;       // records not read yet
+};
+
+inline const traceFileHeader *traceOpen(const void *data, size_t size,
+                                        traceCursor *c) {
+    const traceFileHeader *h = (const traceFileHeader *)data;
+    if (size < sizeof(*h) || memcmp(h->magic, TRACE_MAGIC, 4) != 0 ||
+        h->version != TRACE_VERSION) {
+        return 0;
+    }
+    c->next = (const uint8_t *)data + sizeof(*h);
+    c->end = (const uint8_t *)data + size;
+    c->left = h->count;
+    return h;
+}
+
+// returns false at the end, or on a record that runs past the file
+inline bool traceNext(traceCursor *c, traceHeader *h,
+                      const traceSample **samples) {
+    if (!c->left || (size_t)(c->end - c->next) < sizeof(traceHeader)) {
+        return false;
+    }
+    traceHeader t;
+    memcpy(&t, c->next, sizeof(t));
+    size_t bytes = (size_t)t.length * sizeof(traceSample);
+    if ((size_t)(c->end - c->next) - sizeof(traceHeader) < bytes) return false;
+
+    *h = t;
+    *samples = (const traceSample *)(c->next + sizeof(traceHeader));
+    c->next += sizeof(traceHeader) + bytes;
+    c->left--;
+    return true;
+}
+
+#endif
@@ -0,0 +1,220 @@
+// Host replay of recorded LIS3DH traces (see trace.h)
+//
+// runs every trace of one or more corpus files through the device
+// pipeline (pipeline.h: capture filter, fingerprint, matcher, with the
+// firmware's settings) and compares every unlock with every key, the way
+// validateSequence() decides for one slot: fingerprint screen, then
+// matchGesture(). An unlock is genuine for the keys of its own gesture
+// id and an impostor for all others. Prints FAR/FRR and the throughput.
+//
+//   pio run -e trace_replay
+//   .pio/build/trace_replay/program [-v] [-r repeat] corpus.trc...
+//
+//   -v   one line per comparison (distance and decision)
+//   -r   replay the whole corpus this many times (steadier timing)
+#include "../pipeline.h"
+#include "trace.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// one trace after the pipeline: at most TIMER_COUNT samples, as recorded
+struct capture {
+    uint16_t gesture;
+    uint8_t kind;
+    uint16_t length;
+    packedSample samples[TIMER_COUNT];
+    fingerprint print;
+};
+
+struct mapping {
+    const char *path;
+    void *data;
+    size_t size;
+};
+
+struct tally {
+    unsigned long genuine;
+    unsigned long impostor;
+    unsigned long falseRejects;
+    unsigned long falseAccepts;
+    unsigned long screened;     // comparisons that never reached the matcher
+};
+
+static const char *matcherName[] = {"float", "fixed", "dtw"};
+
+static double seconds() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static bool mapFile(const char *path, mapping *m) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror(path);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    fprintf(stderr, "%s: empty or unreadable\n", path);
+    close(fd);
+    return false;
+  }
+  m->path = path;
+  m->size = st.st_size;
+  m->data = mmap(0, m->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (m->data == MAP_FAILED) {
+    perror(path);
+    return false;
+  }
+  return true;
+}
+
+// the firmware's capture: raw samples through the filter, the first
+// TIMER_COUNT outputs kept, fingerprinted as they come
+static void record(const traceHeader &h, const traceSample *raw, capture *c) {
+  sentryFilter filter;
+  fingerprintAcc acc;
+  fingerprintBegin(acc);
+
+  c->gesture = h.gesture;
+  c->kind = h.kind;
+  c->length = 0;
+  for (uint32_t i = 0; i < h.length && c->length < TIMER_COUNT; i++) {
+    packedSample s;
+    if (filter.update(raw[i].x, raw[i].y, raw[i].z, &s)) {
+      fingerprintAdd(acc, s);
+      c->samples[c->length++] = s;
+    }
+  }
+  fingerprintEnd(acc, &c->print);
+}
+
+// returns false if a file does not hold traces at ACCEL_ODR
+static bool load(const std::vector<mapping> &files, std::vector<capture> *keys,
+                 std::vector<capture> *unlocks) {
+  keys->clear();
+  unlocks->clear();
+  for (size_t f = 0; f < files.size(); f++) {
+    traceCursor cur;
+    const traceFileHeader *fh = traceOpen(files[f].data, files[f].size, &cur);
+    if (!fh) {
+      fprintf(stderr, "%s: not a version %d trace file\n", files[f].path, TRACE_VERSION);
+      return false;
+    }
+    if (fh->odr != ACCEL_ODR) {
+      fprintf(stderr, "%s: recorded at %uHz, the pipeline runs at %dHz\n",
+              files[f].path, fh->odr, ACCEL_ODR);
+      return false;
+    }
+
+    traceHeader h;
+    const traceSample *raw;
+    while (traceNext(&cur, &h, &raw)) {
+      capture c;
+      record(h, raw, &c);
+      if (h.kind == TRACE_KEY) keys->push_back(c);
+      else unlocks->push_back(c);
+    }
+    if (cur.left) {
+      fprintf(stderr, "%s: truncated, %u traces missing\n", files[f].path, cur.left);
+      return false;
+    }
+  }
+  return true;
+}
+
+// same tests, same order as validateSequence() with one key
+static bool decide(const capture &key, const capture &unlock, uint16_t *distance) {
+  *distance = fingerprintDistance(key.print, unlock.print);
+  if (*distance > FP_REJECT_DISTANCE) return false;
+  const gesture k = {key.samples, key.length};
+  const gesture u = {unlock.samples, unlock.length};
+  return matchGesture(k, u);
+}
+
+static void compare(const std::vector<capture> &keys,
+                    const std::vector<capture> &unlocks, tally *t, bool verbose) {
+  for (size_t u = 0; u < unlocks.size(); u++) {
+    for (size_t k = 0; k < keys.size(); k++) {
+      uint16_t distance;
+      bool pass = decide(keys[k], unlocks[u], &distance);
+      bool genuine = keys[k].gesture == unlocks[u].gesture;
+      if (distance > FP_REJECT_DISTANCE) t->screened++;
+      if (genuine) {
+        t->genuine++;
+        if (!pass) t->falseRejects++;
+      } else {
+        t->impostor++;
+        if (pass) t->falseAccepts++;
+      }
+      if (verbose) {
+        printf("unlock %lu (gesture %u) key %lu (gesture %u): distance %u %s%s\n",
+               (unsigned long)u, unlocks[u].gesture, (unsigned long)k, keys[k].gesture,
+               distance, pass ? "pass" : "fail",
+               pass != genuine ? (genuine ? " FALSE REJECT" : " FALSE ACCEPT") : "");
+      }
+    }
+  }
+}
+
+static double percent(unsigned long part, unsigned long whole) {
+  return whole ? 100.0 * part / whole : 0.0;
+}
+
+int main(int argc, char **argv) {
+  long repeat = 1;
+  bool verbose = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "vr:")) != -1) {
+    if (opt == 'v') verbose = true;
+    else if (opt == 'r') repeat = atol(optarg);
+    else break;
+  }
+  if (optind >= argc || repeat < 1) {
+    fprintf(stderr, "usage: %s [-v] [-r repeat] corpus.trc...\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<mapping> files;
+  for (int i = optind; i < argc; i++) {
+    mapping m;
+    if (!mapFile(argv[i], &m)) return 1;
+    files.push_back(m);
+  }
+
+  std::vector<capture> keys, unlocks;
+  tally t;
+  double start = seconds();
+  for (long r = 0; r < repeat; r++) {
+    if (!load(files, &keys, &unlocks)) return 1;
+    memset(&t, 0, sizeof(t));
+    compare(keys, unlocks, &t, verbose && r == 0);
+  }
+  double elapsed = seconds() - start;
+
+  unsigned long traces = (keys.size() + unlocks.size()) * repeat;
+  unsigned long comparisons = (t.genuine + t.impostor) * repeat;
+  printf("traces: %lu keys, %lu unlocks at %dHz, %s matcher\n",
+         (unsigned long)keys.size(), (unsigned long)unlocks.size(), ACCEL_ODR,
+         matcherName[MATCHER]);
+  printf("genuine: %lu comparisons, %lu rejected, FRR %.2f%%\n",
+         t.genuine, t.falseRejects, percent(t.falseRejects, t.genuine));
+  printf("impostor: %lu comparisons, %lu accepted, FAR %.2f%%\n",
+         t.impostor, t.falseAccepts, percent(t.falseAccepts, t.impostor));
+  printf("screened: %lu of %lu comparisons\n", t.screened, t.genuine + t.impostor);
+  printf("time: %.3fs for %ld pass(es), %.0f traces/s, %.0f comparisons/s\n",
+         elapsed, repeat, elapsed > 0 ? traces / elapsed : 0.0,
+         elapsed > 0 ? comparisons / elapsed : 0.0);
+
+  for (size_t i = 0; i < files.size(); i++) munmap(files[i].data, files[i].size);
+  return 0;
+}
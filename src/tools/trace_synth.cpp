@@ -0,0 +1,90 @@
+// Synthetic trace corpus generator (see synth.h and trace.h)
+//
+// writes gestures random shapes, each as one key trace and some unlock
+// traces drawn around it, for trace_replay. Same arguments, same file.
+//
+//   pio run -e trace_synth
+//   .pio/build/trace_synth/program [options] corpus.trc
+//
+//   -g gestures   shapes (keys), default 20
+//   -u unlocks    unlock traces per shape, default 5
+//   -r odr        raw sample rate in Hz, default 100
+//   -l seconds    capture length, default 3
+//   -s seed       default 1
+//   -t stretch    +- time stretch fraction, default 0.08
+//   -d delay      +- start delay fraction, default 0.03
+//   -a amplitude  +- amplitude fraction, default 0.15
+//   -o offset     +- mg offset per axis, default 40
+//   -n noise      mg rms noise, default 20
+#include "synth.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+int main(int argc, char **argv) {
+  long gestures = 20, unlocks = 5, odr = 100;
+  double seconds = 3;
+  unsigned long seed = 1;
+  synthSpread spread = {0.08, 0.03, 0.15, 40, 20};
+
+  int opt;
+  while ((opt = getopt(argc, argv, "g:u:r:l:s:t:d:a:o:n:")) != -1) {
+    switch (opt) {
+      case 'g': gestures = atol(optarg); break;
+      case 'u': unlocks = atol(optarg); break;
+      case 'r': odr = atol(optarg); break;
+      case 'l': seconds = atof(optarg); break;
+      case 's': seed = strtoul(optarg, 0, 0); break;
+      case 't': spread.stretch = atof(optarg); break;
+      case 'd': spread.delay = atof(optarg); break;
+      case 'a': spread.amplitude = atof(optarg); break;
+      case 'o': spread.offset = atof(optarg); break;
+      case 'n': spread.noise = atof(optarg); break;
+      default: optind = argc + 1; break;
+    }
+  }
+  uint32_t count = seconds * odr;
+  if (optind != argc - 1 || gestures < 1 || gestures > 65535 || unlocks < 0 ||
+      odr < 1 || odr > 65535 || count < 1) {
+    fprintf(stderr, "usage: %s [-g gestures] [-u unlocks] [-r odr] [-l seconds] [-s seed]\n"
+                    "       [-t stretch] [-d delay] [-a amplitude] [-o offset] [-n noise] corpus.trc\n",
+            argv[0]);
+    return 2;
+  }
+
+  FILE *f = fopen(argv[optind], "wb");
+  if (!f || !traceBegin(f, odr)) {
+    perror(argv[optind]);
+    return 1;
+  }
+
+  synthRandom r;
+  synthSeed(r, seed);
+  std::vector<traceSample> samples(count);
+  uint32_t traces = 0;
+  bool ok = true;
+  for (long g = 0; g < gestures && ok; g++) {
+    synthShape shape;
+    synthShapeMake(r, shape);
+
+    synthVariation v = {1, 0, 1, {0, 0, 0}, spread.noise};
+    synthRender(shape, v, r, count, &samples[0]);
+    ok = traceAppend(f, g, TRACE_KEY, &samples[0], count);
+    traces++;
+
+    for (long u = 0; u < unlocks && ok; u++) {
+      synthVary(r, spread, v);
+      synthRender(shape, v, r, count, &samples[0]);
+      ok = traceAppend(f, g, TRACE_UNLOCK, &samples[0], count);
+      traces++;
+    }
+  }
+  if (!ok || !traceFinish(f, traces) || fclose(f) != 0) {
+    perror(argv[optind]);
+    return 1;
+  }
+  fprintf(stderr, "%s: %u traces of %u samples at %ldHz\n", argv[optind], traces, count, odr);
+  return 0;
+}
@@ -0,0 +1,85 @@
+// cic<R, N> decimator: output timing, unity DC gain, nulls at the output
+// rate and full scale input without overflow
+#include <unity.h>
+#include <cic.h>
+
+#define R 4
+#define N 3
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// pushes count samples of value, returns the outputs in out
+static uint16_t feed(cic<R, N> &f, const int16_t *in, uint16_t count, int16_t *out) {
+  uint16_t n = 0;
+  for (uint16_t i = 0; i < count; i++) {
+    if (f.update(in[i], &out[n])) n++;
+  }
+  return n;
+}
+
+void test_cic_gain(void) {
+  TEST_ASSERT_EQUAL_INT(64, (cic<R, N>::gain()));
+  TEST_ASSERT_EQUAL_INT(4, (cic<4, 1>::gain()));
+  TEST_ASSERT_EQUAL_INT(1, (cic<R, 0>::gain()));
+}
+
+void test_cic_outputs_every_r_samples(void) {
+  cic<R, N> f;
+  int16_t out;
+  for (uint8_t i = 1; i <= 4 * R; i++) {
+    TEST_ASSERT_EQUAL_INT(i % R == 0, f.update(100, &out));
+  }
+}
+
+void test_cic_dc_settles_to_input(void) {
+  cic<R, N> f;
+  int16_t in[8 * R], out[8];
+  for (uint8_t i = 0; i < 8 * R; i++) in[i] = 1000;
+  TEST_ASSERT_EQUAL_INT(8, feed(f, in, 8 * R, out));
+  // the impulse response is N * (R - 1) + 1 input samples long, N outputs
+  for (uint8_t i = N; i < 8; i++) TEST_ASSERT_EQUAL_INT16(1000, out[i]);
+}
+
+void test_cic_nulls_output_rate(void) {
+  // anything periodic over R input samples with zero mean is removed
+  static const int16_t pattern[R] = {900, -300, -700, 100};
+  cic<R, N> f;
+  int16_t in[8 * R], out[8];
+  for (uint8_t i = 0; i < 8 * R; i++) in[i] = 250 + pattern[i % R];
+  TEST_ASSERT_EQUAL_INT(8, feed(f, in, 8 * R, out));
+  for (uint8_t i = N; i < 8; i++) TEST_ASSERT_EQUAL_INT16(250, out[i]);
+}
+
+void test_cic_full_scale(void) {
+  cic<R, N> f;
+  int16_t in[8 * R], out[8];
+  for (uint8_t i = 0; i < 8 * R; i++) in[i] = (i / R) & 1 ? 32767 : -32768;
+  feed(f, in, 8 * R, out);
+  for (uint8_t i = 0; i < 8 * R; i++) in[i] = -32768;
+  feed(f, in, 8 * R, out);
+  for (uint8_t i = N; i < 8; i++) TEST_ASSERT_EQUAL_INT16(-32768, out[i]);
+}
+
+void test_cic_clear(void) {
+  cic<R, N> f;
+  int16_t in[3] = {5000, 5000, 5000}, out[8];
+  feed(f, in, 3, out);
+  f.clear();
+
+  // a cleared filter starts over: first output after R samples, from zeros
+  int16_t zeros[R] = {0};
+  TEST_ASSERT_EQUAL_INT(1, feed(f, zeros, R, out));
+  TEST_ASSERT_EQUAL_INT16(0, out[0]);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_cic_gain);
+  RUN_TEST(test_cic_outputs_every_r_samples);
+  RUN_TEST(test_cic_dc_settles_to_input);
+  RUN_TEST(test_cic_nulls_output_rate);
+  RUN_TEST(test_cic_full_scale);
+  RUN_TEST(test_cic_clear);
+  return UNITY_END();
+}
@@ -0,0 +1,97 @@
+// telemetry framing: COBS in place encoding and decoding, CRC-8
+#include <unity.h>
+#include <cobs.h>
+#include <telemetry.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// encodes data (len bytes), checks there is no 0x00 left and decodes it
+// back; returns the decoded length
+static size_t roundTrip(const uint8_t *data, uint8_t len, uint8_t *decoded) {
+  uint8_t buf[256];
+  memcpy(buf + 1, data, len);
+  cobsEncodeInPlace(buf, len);
+  for (uint16_t i = 0; i <= len; i++) TEST_ASSERT_TRUE(buf[i] != 0);
+  return cobsDecode(buf, len + 1, decoded);
+}
+
+void test_cobs_known_frames(void) {
+  uint8_t buf[8];
+
+  buf[1] = 0x00;
+  cobsEncodeInPlace(buf, 1);
+  static const uint8_t zero[] = {0x01, 0x01};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(zero, buf, 2);
+
+  buf[1] = 0x11; buf[2] = 0x22; buf[3] = 0x00; buf[4] = 0x33;
+  cobsEncodeInPlace(buf, 4);
+  static const uint8_t mixed[] = {0x03, 0x11, 0x22, 0x02, 0x33};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(mixed, buf, 5);
+
+  buf[1] = 0x11; buf[2] = 0x00; buf[3] = 0x00;
+  cobsEncodeInPlace(buf, 3);
+  static const uint8_t trailing[] = {0x02, 0x11, 0x01, 0x01};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(trailing, buf, 4);
+}
+
+void test_cobs_round_trip(void) {
+  uint8_t data[253], decoded[256];
+  uint32_t seed = 12345;
+  for (uint16_t len = 1; len <= 253; len += 6) {
+    for (uint8_t i = 0; i < len; i++) {
+      seed = seed * 1103515245 + 12345;
+      // about one byte in four is zero
+      data[i] = (seed >> 16) & 3 ? (uint8_t)(seed >> 24) : 0;
+    }
+    TEST_ASSERT_EQUAL_INT(len, roundTrip(data, len, decoded));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, decoded, len);
+  }
+}
+
+void test_cobs_all_zeros_and_none(void) {
+  uint8_t data[200], decoded[256];
+  memset(data, 0, sizeof(data));
+  TEST_ASSERT_EQUAL_INT(200, roundTrip(data, 200, decoded));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data, decoded, 200);
+
+  memset(data, 0xA5, sizeof(data));
+  TEST_ASSERT_EQUAL_INT(200, roundTrip(data, 200, decoded));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data, decoded, 200);
+}
+
+void test_cobs_malformed(void) {
+  uint8_t out[16];
+  static const uint8_t zeroCode[] = {0x02, 0x11, 0x00};
+  TEST_ASSERT_EQUAL_INT(0, cobsDecode(zeroCode, sizeof(zeroCode), out));
+  static const uint8_t overrun[] = {0x05, 0x11, 0x22};
+  TEST_ASSERT_EQUAL_INT(0, cobsDecode(overrun, sizeof(overrun), out));
+}
+
+void test_crc8(void) {
+  // CRC-8 poly 0x07, init 0: the standard check value
+  static const uint8_t check[] = "123456789";
+  TEST_ASSERT_EQUAL_HEX8(0xF4, crc8(check, 9));
+  TEST_ASSERT_EQUAL_HEX8(0x00, crc8(check, 0));
+
+  // appending the CRC gives a remainder of zero, any flipped bit does not
+  uint8_t frame[10];
+  memcpy(frame, check, 9);
+  frame[9] = crc8(frame, 9);
+  TEST_ASSERT_EQUAL_HEX8(0x00, crc8(frame, 10));
+  for (uint8_t bit = 0; bit < 80; bit++) {
+    frame[bit / 8] ^= 1 << (bit % 8);
+    TEST_ASSERT_TRUE(crc8(frame, 10) != 0);
+    frame[bit / 8] ^= 1 << (bit % 8);
+  }
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_cobs_known_frames);
+  RUN_TEST(test_cobs_round_trip);
+  RUN_TEST(test_cobs_all_zeros_and_none);
+  RUN_TEST(test_cobs_malformed);
+  RUN_TEST(test_crc8);
+  return UNITY_END();
+}
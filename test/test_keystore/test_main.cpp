@@ -0,0 +1,156 @@
+// keystore against the simulated EEPROM of hal_native.cpp
+#include <unity.h>
+#include <hal.h>
+#include <keystore.h>
+
+#define RATE 25
+#define LENGTH 75
+
+static packedSample samples[KEYSTORE_MAX_LENGTH];
+static packedSample loaded[KEYSTORE_MAX_LENGTH];
+
+// every test starts from an erased chip
+void setUp(void) {
+  for (uint16_t addr = 0; addr < HAL_EEPROM_SIZE; addr++) halEepromWrite(addr, 0xFF);
+}
+
+void tearDown(void) {}
+
+static void makeKey(uint8_t id, uint8_t length) {
+  for (uint8_t i = 0; i < length; i++) {
+    samples[i].x = (int8_t)(id * 31 + i);
+    samples[i].y = (int8_t)(id * 17 - i);
+    samples[i].z = (int8_t)(i * 3);
+  }
+}
+
+void test_keystore_empty(void) {
+  TEST_ASSERT_EQUAL_INT(0, keystoreCount(RATE, LENGTH));
+  for (uint8_t slot = 0; slot < KEYSTORE_SLOTS; slot++) {
+    TEST_ASSERT_FALSE(keystoreValid(slot, RATE, LENGTH));
+    TEST_ASSERT_EQUAL_INT(0, keystoreLength(slot, RATE));
+  }
+}
+
+void test_keystore_save_load(void) {
+  makeKey(1, LENGTH);
+  int8_t slot = keystoreSave(RATE, LENGTH, samples);
+  TEST_ASSERT_EQUAL_INT(0, slot);
+  TEST_ASSERT_TRUE(keystoreValid(slot, RATE, LENGTH));
+  TEST_ASSERT_EQUAL_INT(LENGTH, keystoreLength(slot, RATE));
+  TEST_ASSERT_EQUAL_INT(1, keystoreCount(RATE, LENGTH));
+
+  TEST_ASSERT_TRUE(keystoreLoad(slot, RATE, LENGTH, loaded));
+  TEST_ASSERT_EQUAL_MEMORY(samples, loaded, LENGTH * sizeof(packedSample));
+  for (uint8_t i = 0; i < LENGTH; i++) {
+    packedSample s = keystoreSample(slot, i);
+    TEST_ASSERT_EQUAL_MEMORY(&samples[i], &s, sizeof(s));
+  }
+}
+
+void test_keystore_rate_and_length(void) {
+  makeKey(2, 40);
+  int8_t slot = keystoreSave(RATE, 40, samples);
+  TEST_ASSERT_FALSE(keystoreValid(slot, RATE + 1, 40));
+  TEST_ASSERT_FALSE(keystoreValid(slot, RATE, LENGTH));
+  TEST_ASSERT_TRUE(keystoreValid(slot, RATE, KEYSTORE_ANY_LENGTH));
+  TEST_ASSERT_EQUAL_INT(0, keystoreLength(slot, RATE + 1));
+  TEST_ASSERT_EQUAL_INT(40, keystoreLength(slot, RATE));
+  TEST_ASSERT_EQUAL_INT(0, keystoreCount(RATE, LENGTH));
+  TEST_ASSERT_EQUAL_INT(1, keystoreCount(RATE, KEYSTORE_ANY_LENGTH));
+
+  TEST_ASSERT_EQUAL_INT(-1, keystoreSave(RATE, 0, samples));
+  TEST_ASSERT_EQUAL_INT(-1, keystoreSave(RATE, KEYSTORE_MAX_LENGTH + 1, samples));
+}
+
+void test_keystore_reuses_oldest(void) {
+  for (uint8_t id = 0; id < KEYSTORE_SLOTS; id++) {
+    makeKey(id, LENGTH);
+    TEST_ASSERT_EQUAL_INT(id, keystoreSave(RATE, LENGTH, samples));
+  }
+  TEST_ASSERT_EQUAL_INT(KEYSTORE_SLOTS, keystoreCount(RATE, LENGTH));
+
+  // full: the oldest slot goes first, then the next oldest
+  makeKey(10, LENGTH);
+  TEST_ASSERT_EQUAL_INT(0, keystoreSave(RATE, LENGTH, samples));
+  makeKey(11, LENGTH);
+  TEST_ASSERT_EQUAL_INT(1, keystoreSave(RATE, LENGTH, samples));
+  TEST_ASSERT_TRUE(keystoreLoad(1, RATE, LENGTH, loaded));
+  TEST_ASSERT_EQUAL_MEMORY(samples, loaded, LENGTH * sizeof(packedSample));
+  TEST_ASSERT_EQUAL_INT(KEYSTORE_SLOTS, keystoreCount(RATE, LENGTH));
+}
+
+void test_keystore_sequence_wraps(void) {
+  // 300 saves wrap the 8 bit sequence, still oldest first
+  for (uint16_t n = 0; n < 300; n++) {
+    makeKey(n, LENGTH);
+    TEST_ASSERT_EQUAL_INT(n % KEYSTORE_SLOTS, keystoreSave(RATE, LENGTH, samples));
+  }
+}
+
+void test_keystore_crc(void) {
+  makeKey(3, LENGTH);
+  int8_t slot = keystoreSave(RATE, LENGTH, samples);
+  uint16_t addr = slot * KEYSTORE_SLOT_BYTES + KEYSTORE_HEADER + 100;
+  uint8_t b = halEepromRead(addr);
+
+  halEepromWrite(addr, b ^ 0x10);
+  TEST_ASSERT_FALSE(keystoreValid(slot, RATE, LENGTH));
+  TEST_ASSERT_EQUAL_INT(0, keystoreCount(RATE, LENGTH));
+  halEepromWrite(addr, b);
+  TEST_ASSERT_TRUE(keystoreValid(slot, RATE, LENGTH));
+}
+
+void test_keystore_interrupted_save(void) {
+  // a save cut short leaves the version byte empty, the slot is reused
+  makeKey(4, LENGTH);
+  keystoreSave(RATE, LENGTH, samples);
+  halEepromWrite(0, 0xFF);
+  TEST_ASSERT_EQUAL_INT(0, keystoreCount(RATE, LENGTH));
+  TEST_ASSERT_EQUAL_INT(0, keystoreSave(RATE, LENGTH, samples));
+}
+
+void test_keystore_erase(void) {
+  makeKey(5, LENGTH);
+  keystoreSave(RATE, LENGTH, samples);
+  keystoreSave(RATE, LENGTH, samples);
+  TEST_ASSERT_EQUAL_INT(2, keystoreCount(RATE, LENGTH));
+  keystoreErase();
+  TEST_ASSERT_EQUAL_INT(0, keystoreCount(RATE, LENGTH));
+  TEST_ASSERT_EQUAL_INT(0, keystoreSave(RATE, LENGTH, samples));
+}
+
+void test_keystore_incremental_save(void) {
+  makeKey(6, LENGTH);
+  keystoreWriter w;
+  TEST_ASSERT_EQUAL_INT(0, keystoreSaveBegin(w, RATE, LENGTH, samples));
+
+  // one byte per step: version emptied, payload, header bytes 5..1 and
+  // the version, the slot reads as empty until the last one
+  uint16_t steps = 1;
+  while (!keystoreSaveStep(w)) {
+    TEST_ASSERT_FALSE(keystoreValid(0, RATE, LENGTH));
+    steps++;
+  }
+  TEST_ASSERT_EQUAL_INT(LENGTH * sizeof(packedSample) + KEYSTORE_HEADER + 1, steps);
+  TEST_ASSERT_TRUE(keystoreLoad(0, RATE, LENGTH, loaded));
+  TEST_ASSERT_EQUAL_MEMORY(samples, loaded, LENGTH * sizeof(packedSample));
+
+  // the next one goes to the next slot, a bad length to none
+  TEST_ASSERT_EQUAL_INT(1, keystoreSaveBegin(w, RATE, LENGTH, samples));
+  TEST_ASSERT_EQUAL_INT(-1, keystoreSaveBegin(w, RATE, 0, samples));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_keystore_empty);
+  RUN_TEST(test_keystore_save_load);
+  RUN_TEST(test_keystore_rate_and_length);
+  RUN_TEST(test_keystore_reuses_oldest);
+  RUN_TEST(test_keystore_sequence_wraps);
+  RUN_TEST(test_keystore_crc);
+  RUN_TEST(test_keystore_interrupted_save);
+  RUN_TEST(test_keystore_erase);
+  RUN_TEST(test_keystore_incremental_save);
+  return UNITY_END();
+}
@@ -0,0 +1,223 @@
+// float, fixed point, streaming and DTW matchers, lag alignment
+#include <unity.h>
+#include <matcher.h>
+#include <math.h>
+
+#define LENGTH 75
+
+static packedSample keyBuf[LENGTH + 16];
+static packedSample unlockBuf[LENGTH + 16];
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static uint32_t seed;
+
+static int16_t randomIn(int16_t lo, int16_t hi) {
+  seed = seed * 1103515245 + 12345;
+  return lo + (int16_t)((seed >> 16) % (uint32_t)(hi - lo + 1));
+}
+
+static int8_t clamp8(double v) {
+  if (v > 127) return 127;
+  if (v < -128) return -128;
+  return (int8_t)lround(v);
+}
+
+// a smooth gesture in quantized units, t in samples, stretch 1 is the key
+static packedSample shape(double t, double stretch) {
+  double p = 2 * M_PI * t / (LENGTH * stretch);
+  packedSample s = {clamp8(20 + 60 * sin(4 * p)),
+                    clamp8(-10 + 60 * sin(6 * p + 1)),
+                    clamp8(30 + 50 * cos(3 * p))};
+  return s;
+}
+
+static gesture render(packedSample *buf, uint16_t length, double stretch) {
+  for (uint16_t i = 0; i < length; i++) buf[i] = shape(i, stretch);
+  gesture g = {buf, length};
+  return g;
+}
+
+void test_match_identical_passes(void) {
+  gesture key = render(keyBuf, LENGTH, 1);
+  gesture unlock = render(unlockBuf, LENGTH, 1);
+  TEST_ASSERT_TRUE(matchFloat(key, unlock));
+  TEST_ASSERT_TRUE(matchFixed(key, unlock));
+  TEST_ASSERT_TRUE(matchDtw(key, unlock));
+  TEST_ASSERT_TRUE(matchGesture(key, unlock));
+}
+
+void test_match_mirrored_fails(void) {
+  gesture key = render(keyBuf, LENGTH, 1);
+  for (uint16_t i = 0; i < LENGTH; i++) {
+    unlockBuf[i].x = -keyBuf[i].x;
+    unlockBuf[i].y = -keyBuf[i].y;
+    unlockBuf[i].z = -keyBuf[i].z;
+  }
+  gesture unlock = {unlockBuf, LENGTH};
+  TEST_ASSERT_FALSE(matchFloat(key, unlock));
+  TEST_ASSERT_FALSE(matchFixed(key, unlock));
+  TEST_ASSERT_FALSE(matchDtw(key, unlock));
+  TEST_ASSERT_FALSE(matchGesture(key, unlock));
+}
+
+void test_match_zero_key_fails(void) {
+  // a zero key value leaves no tolerance, same as the float division by zero
+  for (uint16_t i = 0; i < LENGTH; i++) {
+    packedSample zero = {0, 0, 0};
+    keyBuf[i] = zero;
+    unlockBuf[i] = zero;
+  }
+  gesture key = {keyBuf, LENGTH};
+  gesture unlock = {unlockBuf, LENGTH};
+  TEST_ASSERT_FALSE(matchFloat(key, unlock));
+  TEST_ASSERT_FALSE(matchFixed(key, unlock));
+}
+
+void test_match_fixed_agrees_with_float(void) {
+  // random keys with zeros, unlocks scattered around the 50% tolerance
+  seed = 1;
+  gesture key = {keyBuf, LENGTH};
+  gesture unlock = {unlockBuf, LENGTH};
+  uint16_t passed = 0;
+  for (uint16_t trial = 0; trial < 2000; trial++) {
+    for (uint16_t i = 0; i < LENGTH; i++) {
+      int8_t *k = &keyBuf[i].x;
+      int8_t *u = &unlockBuf[i].x;
+      for (uint8_t a = 0; a < 3; a++) {
+        k[a] = randomIn(0, 9) == 0 ? 0 : randomIn(-128, 127);
+        int16_t v = k[a] + (int16_t)k[a] * randomIn(-60, 60) / 100 + randomIn(-1, 1);
+        u[a] = clamp8(v);
+      }
+    }
+    bool f = matchFloat(key, unlock);
+    TEST_ASSERT_EQUAL_INT(f, matchFixed(key, unlock));
+    passed += f;
+  }
+  // both outcomes were exercised
+  TEST_ASSERT_TRUE(passed > 0 && passed < 2000);
+}
+
+void test_match_stream_is_fixed(void) {
+  seed = 7;
+  gesture key = render(keyBuf, LENGTH, 1);
+  gesture unlock = {unlockBuf, LENGTH};
+  for (uint16_t trial = 0; trial < 200; trial++) {
+    for (uint16_t i = 0; i < LENGTH; i++) {
+      unlockBuf[i].x = clamp8(keyBuf[i].x + randomIn(-40, 40));
+      unlockBuf[i].y = clamp8(keyBuf[i].y + randomIn(-40, 40));
+      unlockBuf[i].z = clamp8(keyBuf[i].z + randomIn(-40, 40));
+    }
+    matchStream m;
+    matchStreamBegin(m);
+    bool alive = true;
+    for (uint16_t i = 0; i < LENGTH; i++) {
+      alive = matchStreamPush(m, keyBuf[i], unlockBuf[i]) && alive;
+    }
+    TEST_ASSERT_EQUAL_INT(matchFixed(key, unlock), alive);
+    TEST_ASSERT_EQUAL_INT(alive, matchStreamAlive(m));
+  }
+}
+
+void test_match_lengths(void) {
+  TEST_ASSERT_TRUE(matchLengths(LENGTH, LENGTH + MATCH_LENGTH_SLACK));
+  TEST_ASSERT_TRUE(matchLengths(LENGTH, LENGTH - MATCH_LENGTH_SLACK));
+  TEST_ASSERT_FALSE(matchLengths(LENGTH, LENGTH + MATCH_LENGTH_SLACK + 1));
+
+  gesture key = render(keyBuf, LENGTH, 1);
+  gesture unlock = render(unlockBuf, LENGTH + MATCH_LENGTH_SLACK + 1, 1);
+  TEST_ASSERT_FALSE(matchFixed(key, unlock));
+  TEST_ASSERT_FALSE(matchFloat(key, unlock));
+  unlock.length = LENGTH + MATCH_LENGTH_SLACK;
+  TEST_ASSERT_TRUE(matchFixed(key, unlock));
+}
+
+void test_match_align_finds_lag(void) {
+  // noise has a sharp autocorrelation peak, one window of it is the key
+  packedSample base[LENGTH + 2 * MATCH_LAG_MAX];
+  seed = 3;
+  for (uint16_t i = 0; i < LENGTH + 2 * MATCH_LAG_MAX; i++) {
+    base[i].x = randomIn(-100, 100);
+    base[i].y = randomIn(-100, 100);
+    base[i].z = randomIn(-100, 100);
+  }
+  for (uint16_t i = 0; i < LENGTH; i++) keyBuf[i] = base[i + MATCH_LAG_MAX];
+  gesture key = {keyBuf, LENGTH};
+
+  for (int8_t lag = -MATCH_LAG_MAX; lag <= MATCH_LAG_MAX; lag++) {
+    // unlock sample i + lag is key sample i
+    for (uint16_t i = 0; i < LENGTH; i++) unlockBuf[i] = base[i + MATCH_LAG_MAX - lag];
+    gesture unlock = {unlockBuf, LENGTH};
+    TEST_ASSERT_EQUAL_INT(lag, matchAlign(key, unlock));
+    TEST_ASSERT_TRUE(matchGesture(key, unlock));
+  }
+}
+
+void test_match_corr_tie_keeps_smallest_lag(void) {
+  matchCorr c;
+  packedSample zero = {0, 0, 0};
+  matchCorrBegin(c, zero);
+  TEST_ASSERT_EQUAL_INT(0, matchCorrBest(c));
+
+  // equal averages at -2 and +2 (different counts), both above lag 0
+  packedSample one = {1, 1, 1};
+  for (uint8_t i = 0; i < 4; i++) matchCorrPush(c, -2, one, one);
+  for (uint8_t i = 0; i < 8; i++) matchCorrPush(c, 2, one, one);
+  TEST_ASSERT_EQUAL_INT(-2, matchCorrBest(c));
+}
+
+void test_match_corr_long_overlap(void) {
+  // sums past 2^31 / count must still compare correctly
+  matchCorr c;
+  packedSample zero = {0, 0, 0};
+  packedSample big = {127, 127, 127};
+  packedSample low = {-128, -128, -128};
+  matchCorrBegin(c, zero);
+  for (uint8_t i = 0; i < 250; i++) matchCorrPush(c, 1, big, big);
+  for (uint8_t i = 0; i < 250; i++) matchCorrPush(c, 0, big, low);
+  for (uint8_t i = 0; i < 249; i++) matchCorrPush(c, -1, big, big);
+  matchCorrPush(c, -1, zero, big);
+  TEST_ASSERT_EQUAL_INT(1, matchCorrBest(c));
+}
+
+void test_match_dtw_takes_tempo(void) {
+  // a 10% slower or faster performance: the sample by sample test drifts
+  // out of step, the warping path follows it
+  gesture key = render(keyBuf, LENGTH, 1);
+  gesture slow = render(unlockBuf, LENGTH, 1.1);
+  TEST_ASSERT_FALSE(matchFixed(key, slow));
+  TEST_ASSERT_TRUE(matchDtw(key, slow));
+
+  gesture fast = render(unlockBuf, LENGTH, 0.9);
+  TEST_ASSERT_FALSE(matchFixed(key, fast));
+  TEST_ASSERT_TRUE(matchDtw(key, fast));
+}
+
+void test_match_dtw_band(void) {
+  // the end of the path has to stay inside the band
+  gesture key = render(keyBuf, LENGTH, 1);
+  gesture unlock = render(unlockBuf, LENGTH + MATCH_DTW_BAND + 1, 1);
+  TEST_ASSERT_FALSE(matchDtw(key, unlock));
+  unlock.length = LENGTH + MATCH_DTW_BAND;
+  TEST_ASSERT_TRUE(matchDtw(key, unlock));
+
+  key.length = MATCH_START;
+  TEST_ASSERT_FALSE(matchDtw(key, key));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_match_identical_passes);
+  RUN_TEST(test_match_mirrored_fails);
+  RUN_TEST(test_match_zero_key_fails);
+  RUN_TEST(test_match_fixed_agrees_with_float);
+  RUN_TEST(test_match_stream_is_fixed);
+  RUN_TEST(test_match_lengths);
+  RUN_TEST(test_match_align_finds_lag);
+  RUN_TEST(test_match_corr_tie_keeps_smallest_lag);
+  RUN_TEST(test_match_corr_long_overlap);
+  RUN_TEST(test_match_dtw_takes_tempo);
+  RUN_TEST(test_match_dtw_band);
+  return UNITY_END();
+}
@@ -0,0 +1,96 @@
+// movingavg<N>: zero primed window divided by the full window size
+#include <unity.h>
+#include <movingavg.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_movingavg_warm_up(void) {
+  // the window starts out as zeros, so a step climbs over N samples
+  movingavg<4> f;
+  TEST_ASSERT_EQUAL_INT16(100, f.update(400));
+  TEST_ASSERT_EQUAL_INT16(200, f.update(400));
+  TEST_ASSERT_EQUAL_INT16(300, f.update(400));
+  TEST_ASSERT_EQUAL_INT16(400, f.update(400));
+  TEST_ASSERT_EQUAL_INT16(400, f.update(400));
+}
+
+void test_movingavg_drops_oldest(void) {
+  movingavg<3> f;
+  f.update(30);
+  f.update(60);
+  f.update(90);
+  TEST_ASSERT_EQUAL_INT16(80, f.update(90));   // (60 + 90 + 90) / 3
+  TEST_ASSERT_EQUAL_INT16(60, f.update(0));    // (90 + 90 + 0) / 3
+}
+
+void test_movingavg_truncates_toward_zero(void) {
+  movingavg<4> f;
+  TEST_ASSERT_EQUAL_INT16(-1, f.update(-7));   // -7 / 4
+  TEST_ASSERT_EQUAL_INT16(0, f.update(5));     // -2 / 4
+}
+
+void test_movingavg_full_scale(void) {
+  // the sum is 32 bit, a full window of int16 extremes does not overflow
+  movingavg<31> f;
+  int16_t out = 0;
+  for (uint8_t i = 0; i < 31; i++) out = f.update(-32768);
+  TEST_ASSERT_EQUAL_INT16(-32768, out);
+  for (uint8_t i = 0; i < 31; i++) out = f.update(32767);
+  TEST_ASSERT_EQUAL_INT16(32767, out);
+}
+
+void test_movingavg_clear(void) {
+  movingavg<4> f;
+  for (uint8_t i = 0; i < 6; i++) f.update(1000);
+  f.clear();
+  TEST_ASSERT_EQUAL_INT16(25, f.update(100));
+}
+
+// the filter movingavg replaced: shift the window up one slot, summing
+// as it goes, put the new sample in front, divide by the full window
+template <uint8_t N>
+struct shiftAverage {
+  int16_t window[N];
+
+  shiftAverage() { memset(window, 0, sizeof(window)); }
+
+  int16_t update(int16_t sample) {
+    int32_t avg = 0;
+    for (int i = N - 2; i > -1; i--) {
+      window[i + 1] = window[i];
+      avg += window[i + 1];
+    }
+    window[0] = sample;
+    return (avg + sample) / N;
+  }
+};
+
+void test_movingavg_matches_shift_loop(void) {
+  // random 12 bit readings (the LIS3DH range after >> 4) and full range
+  // int16, restarted now and then like a new capture
+  movingavg<31> f;
+  shiftAverage<31> ref;
+  uint32_t seed = 2024;
+  for (uint32_t n = 0; n < 200000; n++) {
+    seed = seed * 1103515245 + 12345;
+    int16_t sample = n < 100000 ? (int16_t)((seed >> 8) & 0xFFF) - 2048
+                                : (int16_t)(seed >> 16);
+    if (n % 10007 == 0) {
+      f.clear();
+      ref = shiftAverage<31>();
+    }
+    TEST_ASSERT_EQUAL_INT16(ref.update(sample), f.update(sample));
+  }
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_movingavg_warm_up);
+  RUN_TEST(test_movingavg_drops_oldest);
+  RUN_TEST(test_movingavg_truncates_toward_zero);
+  RUN_TEST(test_movingavg_full_scale);
+  RUN_TEST(test_movingavg_clear);
+  RUN_TEST(test_movingavg_matches_shift_loop);
+  return UNITY_END();
+}